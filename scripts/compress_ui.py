@@ -0,0 +1,59 @@
+# Gzips the web UI into a C header before the firmware is built, so the
+# ESP32 can serve it precompressed, with an ETag for conditional requests.
+#
+# PlatformIO runs this as a pre: extra script and puts the header in
+# $BUILD_DIR/generated. It can also be run by hand:
+#   python scripts/compress_ui.py <output dir>
+
+import gzip
+import hashlib
+import os
+import sys
+
+UI_FILE = os.path.join("ui", "index.html")
+HEADER = "index_html_gz.h"
+
+
+def generate(project_dir, out_dir):
+    with open(os.path.join(project_dir, UI_FILE), "rb") as f:
+        html = f.read()
+    # mtime=0 keeps the bytes, and so the ETag, stable across builds
+    data = gzip.compress(html, compresslevel=9, mtime=0)
+    etag = '"%s"' % hashlib.sha1(data).hexdigest()[:16]
+
+    lines = [
+        "// Generated by scripts/compress_ui.py from %s, do not edit" % UI_FILE.replace(os.sep, "/"),
+        "#pragma once",
+        "",
+        "#include <Arduino.h>",
+        "",
+        "#define INDEX_HTML_GZ_LEN %d" % len(data),
+        "#define INDEX_HTML_ETAG \"%s\"" % etag.replace('"', '\\"'),
+        "",
+        "const uint8_t index_html_gz[] PROGMEM = {",
+    ]
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    lines += ["};", ""]
+    text = "\n".join(lines)
+
+    os.makedirs(out_dir, exist_ok=True)
+    path = os.path.join(out_dir, HEADER)
+    # Leave the header alone when nothing changed so main.cpp is not rebuilt
+    if os.path.exists(path):
+        with open(path) as f:
+            if f.read() == text:
+                return
+    with open(path, "w") as f:
+        f.write(text)
+    print("UI: %s %d -> %d bytes gzipped, ETag %s" % (UI_FILE, len(html), len(data), etag))
+
+
+try:
+    Import("env")  # noqa: F821, provided by PlatformIO
+except NameError:
+    generate(os.path.dirname(os.path.dirname(os.path.abspath(__file__))), sys.argv[1])
+else:
+    out_dir = os.path.join(env.subst("$BUILD_DIR"), "generated")  # noqa: F821
+    generate(env.subst("$PROJECT_DIR"), out_dir)  # noqa: F821
+    env.Append(CPPPATH=[out_dir])  # noqa: F821
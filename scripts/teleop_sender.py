@@ -0,0 +1,105 @@
+# Streams teleop setpoint packets (format in src/Control/Teleop.h) and reports
+# loss, stale drops and round-trip latency from the acks. Against the native
+# build on loopback:
+#
+#   .pio/build/native/program teleop 4210 20 &
+#   python scripts/teleop_sender.py --rate 200 --seconds 10
+#
+# or against the board with --host 192.168.4.1. --reorder sends that fraction
+# of packets swapped with their successor, which the receiver must drop.
+
+import argparse
+import math
+import random
+import socket
+import struct
+import time
+
+VERSION = 1
+JOINTS = 2
+PACKET = struct.Struct("<BBHII%df" % JOINTS)
+ACK = struct.Struct("<BBHII")
+STATUS = ("accepted", "stale", "malformed")
+
+
+def percentile(values, p):
+    if not values:
+        return float("nan")
+    values = sorted(values)
+    return values[min(len(values) - 1, int(len(values) * p / 100))]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("--host", default="127.0.0.1")
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--rate", type=float, default=200, help="packets per second")
+    parser.add_argument("--seconds", type=float, default=10)
+    parser.add_argument("--amplitude", type=float, default=30, help="deg, sine on both joints")
+    parser.add_argument("--reorder", type=float, default=0, help="fraction of packets sent out of order")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setblocking(False)
+    target = (args.host, args.port)
+
+    start = time.perf_counter()
+    sent = {}
+    counts = [0, 0, 0]
+    rtts = []
+    held = None
+    seq = 0
+
+    def send(packet_seq, packet):
+        sent[packet_seq] = time.perf_counter()
+        sock.sendto(packet, target)
+
+    def drain():
+        while True:
+            try:
+                data = sock.recv(64)
+            except BlockingIOError:
+                return
+            if len(data) != ACK.size:
+                continue
+            _, status, _, ack_seq, _ = ACK.unpack(data)
+            if status < len(STATUS):
+                counts[status] += 1
+            t = sent.pop(ack_seq, None)
+            if t is not None:
+                rtts.append((time.perf_counter() - t) * 1e6)
+
+    period = 1.0 / args.rate
+    next_time = start
+    while next_time - start < args.seconds:
+        seq += 1
+        t = next_time - start
+        angle = args.amplitude * math.sin(2 * math.pi * 0.5 * t)
+        packet = PACKET.pack(VERSION, JOINTS, 0, seq, int(t * 1e6) & 0xFFFFFFFF, angle, angle)
+        if held is None and random.random() < args.reorder:
+            held = (seq, packet)
+        else:
+            send(seq, packet)
+            if held is not None:
+                send(*held)
+                held = None
+
+        next_time += period
+        while True:
+            drain()
+            remaining = next_time - time.perf_counter()
+            if remaining <= 0:
+                break
+            time.sleep(min(remaining, 0.0005))
+
+    time.sleep(0.2)
+    drain()
+
+    print("sent:     %d packets at %.0f Hz" % (seq, args.rate))
+    print("acked:    %s, lost %d" % (", ".join("%s %d" % kv for kv in zip(STATUS, counts)), len(sent)))
+    print("rtt:      p50 %.0f us, p99 %.0f us, max %.0f us" %
+          (percentile(rtts, 50), percentile(rtts, 99), max(rtts) if rtts else float("nan")))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,60 @@
+#include "Acquisition.h"
+
+#include <utility>
+
+static bool readCounts(Encoder &encoder, JointDescriptor::EncoderRead mode, int32_t &counts) {
+    if (mode == JointDescriptor::ABSOLUTE) {
+        uint16_t raw;
+        if (!encoder.readAngle(raw)) return false;
+        counts = raw;
+        return true;
+    }
+    return encoder.readCumulative(counts);
+}
+
+static JointPipeline makePipeline(const JointDescriptor &joint) {
+    // Cumulative counts are continuous: unwrapping them would turn a reset or
+    // an offset change into a permanent full-turn error
+    const float period = joint.read == JointDescriptor::ABSOLUTE ? 4096.0f : 0.0f;
+    return JointPipeline(Unwrap<>(period), CountsToDegrees<>(), Offset<>(joint.zeroOffset), GearRatio<>(joint.gearRatio),
+                         Kalman<>(Acquisition::ACCEL_VARIANCE, Acquisition::MEAS_VARIANCE));
+}
+
+template <size_t... J>
+static std::array<JointPipeline, JOINT_COUNT> makePipelines(std::index_sequence<J...>) {
+    return {{makePipeline(JOINTS[J])...}};
+}
+
+Acquisition::Acquisition(Encoder *const *encoders, Clock &clock):
+    m_clock(clock), m_pipelines(makePipelines(std::make_index_sequence<JOINT_COUNT>())), m_next(), m_prevTime() {
+    for (int j = 0; j < JOINT_COUNT; j++) m_encoders[j] = encoders[j];
+}
+
+void Acquisition::begin() {
+    unsigned long now = m_clock.micros();
+    for (int j = 0; j < JOINT_COUNT; j++) m_prevTime[j] = now;
+}
+
+void Acquisition::sample() {
+    unsigned long now = m_clock.micros();
+
+    // Encoders on separate buses: start every background read before reading
+    for (int j = 0; j < JOINT_COUNT; j++) m_encoders[j]->prefetch();
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        uint32_t start = m_clock.cycles();
+        m_next.valid[j] = readCounts(*m_encoders[j], JOINTS[j].read, m_next.counts[j]);
+        uint32_t read = m_clock.cycles();
+        readTime[j].record(read - start);
+        if (m_next.valid[j]) {
+            float dt = (now - m_prevTime[j]) * 1e-6f;
+            m_prevTime[j] = now;
+            m_next.angle[j] = m_pipelines[j].process((float)m_next.counts[j], dt);
+            filterTime[j].record(m_clock.cycles() - read);
+        }
+        m_next.velocity[j] = m_pipelines[j].get<Kalman<>>().velocity();
+    }
+
+    m_next.timeUs = m_clock.micros();
+    m_next.seq++;
+    m_state.write(m_next);
+}
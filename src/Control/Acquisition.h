@@ -0,0 +1,65 @@
+#pragma once
+
+#include <stdint.h>
+#include <array>
+
+#include "HAL/HAL.h"
+#include "SeqLock.h"
+#include "Pipeline.h"
+#include "Joints.h"
+#include "Metrics.h"
+
+// One timestamped sample of every joint, one array per quantity.
+struct JointState
+{
+    uint32_t timeUs;                 // clock.micros() when the sample was taken
+    uint32_t seq;                    // sample number
+    float angle[JOINT_COUNT];        // deg, joint side, Kalman filtered; continuous (see Angle.h)
+    float velocity[JOINT_COUNT];     // deg/s, Kalman estimate
+    int32_t counts[JOINT_COUNT];     // raw sensor counts behind the angles (last good read)
+    bool valid[JOINT_COUNT];         // false: sensor read failed, angle is the last good one
+};
+
+// Every joint: sensor counts unwrapped across the 0/4095 rollover (ABSOLUTE
+// joints only; exact, the counts are whole numbers), to degrees, shifted by
+// the joint's zero offset, through its gear, Kalman filtered. Absolute
+// sensors thus give a continuous angle the filter can follow through
+// +-180 deg.
+typedef Pipeline<Unwrap<>, CountsToDegrees<>, Offset<>, GearRatio<>, Kalman<>> JointPipeline;
+
+// Owns the encoders: reads and filters every joint and publishes the result
+// as a JointState snapshot. Only sample() touches the sensors, so everybody
+// else (controller, web handlers, telemetry) reads latest() and never blocks
+// on I2C.
+class Acquisition
+{
+public:
+    // Filter tuning: AS5600 quantisation plus margin, and an acceleration
+    // spread that keeps the position lag to a few samples at 200 Hz - 1 kHz.
+    static constexpr float MEAS_VARIANCE = 0.01f;   // deg^2
+    static constexpr float ACCEL_VARIANCE = 1e7f;   // (deg/s^2)^2
+
+    // One encoder per entry of JOINTS
+    Acquisition(Encoder *const *encoders, Clock &clock);
+
+    void begin();
+    void sample();
+
+    JointState latest() const { return m_state.read(); }
+    uint32_t samples() const { return m_state.version(); }
+
+    // Per joint: the encoder read as seen from here (including any wait for
+    // a prefetch) and the pipeline (unwrap, scaling, Kalman filter)
+    CycleHistogram readTime[JOINT_COUNT];
+    CycleHistogram filterTime[JOINT_COUNT];
+
+private:
+
+    Encoder *m_encoders[JOINT_COUNT];
+    Clock &m_clock;
+
+    std::array<JointPipeline, JOINT_COUNT> m_pipelines;
+    JointState m_next;
+    unsigned long m_prevTime[JOINT_COUNT];  // per joint: a failed read leaves it, so the next dt spans the gap
+    SeqLock<JointState> m_state;
+};
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Joints.h"
+
+// Joints read through an ABSOLUTE sensor turn freely: -179 and 181 deg are
+// the same pose. Internally their angles are continuous (the pipeline unwraps
+// the sensor), so filters and the controller never see a 360 deg jump; the
+// shortest way to a target is taken modulo one turn, and angles are wrapped
+// back into -180..180 only where they leave the controller.
+
+// v into [-period/2, period/2). Values here are at most a few periods out, so
+// this loops at most a couple of times and needs no fmod. Only needs
+// arithmetic and comparisons, so it also serves PID<Q16>'s wrap.
+template <typename T>
+inline T wrapHalf(T v, T period)
+{
+    const T half = period / T(2);
+    while (v >= half) v -= period;
+    while (v < -half) v += period;
+    return v;
+}
+
+inline bool jointWraps(int joint)
+{
+    return JOINTS[joint].read == JointDescriptor::ABSOLUTE;
+}
+
+// Signed distance from angle to target, the short way round on wrapping joints
+inline float angleError(int joint, float target, float angle)
+{
+    float error = target - angle;
+    return jointWraps(joint) ? wrapHalf(error, 360.0f) : error;
+}
+
+// The equivalent of target nearest to angle
+inline float nearestTarget(int joint, float target, float angle)
+{
+    return angle + angleError(joint, target, angle);
+}
+
+// For the API: -180..180 on wrapping joints, as is otherwise
+inline float apiAngle(int joint, float angle)
+{
+    return jointWraps(joint) ? wrapHalf(angle, 360.0f) : angle;
+}
@@ -0,0 +1,174 @@
+#include "Autotune.h"
+
+#include <math.h>
+
+static const float PI_F = 3.14159265f;
+static const float SETTLE_BAND = 0.02f; // of the step
+
+static float clampTo(float v, float limit) {
+    return v < -limit ? -limit : (v > limit ? limit : v);
+}
+
+Autotuner::Autotuner():
+    m_pid(0, 0, 0), m_settings(), m_result(),
+    m_state(IDLE), m_startRequested(false), m_abortRequested(false), m_joint(-1), m_failure(""),
+    m_startUs(0), m_center(0), m_bias(0), m_target(0), m_high(true),
+    m_cycle(0), m_cycleStartUs(0), m_max(0), m_min(0), m_periodSum(0), m_amplitudeSum(0),
+    m_peak(0), m_lastOutsideUs(0) {}
+
+bool Autotuner::start(int joint, const Settings &settings) {
+    if (running() || m_startRequested) return false;
+    m_settings = settings;
+    if (m_settings.cycles < 1) m_settings.cycles = 1;
+    m_joint = joint;
+    m_abortRequested = false;
+    m_startRequested = true;
+    return true;
+}
+
+void Autotuner::fail(const char *reason) {
+    m_failure = reason;
+    m_state = FAILED;
+}
+
+bool Autotuner::step(int joint, float angle, uint32_t nowUs, float &output) {
+    if (joint != m_joint) return false;
+
+    if (m_startRequested) {
+        m_startRequested = false;
+        m_result = Result();
+        m_failure = "";
+        m_startUs = nowUs;
+        m_center = angle;
+        m_target = angle;
+        m_bias = output;
+        m_high = true;
+        m_cycle = 0;
+        m_cycleStartUs = nowUs;
+        m_max = m_min = angle;
+        m_periodSum = m_amplitudeSum = 0;
+        m_state = RELAY;
+    }
+    if (!running()) return false;
+    if (m_abortRequested) {
+        m_abortRequested = false;
+        fail("aborted");
+        return false;
+    }
+
+    float elapsed = (nowUs - m_startUs) * 1e-6f;
+    if (fabsf(angle - m_target) > m_settings.maxDeviation) {
+        fail("joint left the allowed range");
+        return false;
+    }
+
+    if (m_state == RELAY) {
+        if (elapsed > m_settings.timeout) {
+            fail("no steady oscillation");
+            return false;
+        }
+
+        float error = m_center - angle;
+        bool high = m_high;
+        if (error > m_settings.hysteresis) high = true;
+        else if (error < -m_settings.hysteresis) high = false;
+
+        // A switch up starts the next cycle; the first one is only settling
+        if (high && !m_high) {
+            if (m_cycle >= 1) {
+                m_periodSum += (nowUs - m_cycleStartUs) * 1e-6f;
+                m_amplitudeSum += (m_max - m_min) / 2;
+            }
+            m_cycle++;
+            m_cycleStartUs = nowUs;
+            m_max = m_min = angle;
+            if (m_cycle > m_settings.cycles) {
+                finishRelay(nowUs);
+                output = m_pid.compute(angle, nowUs);
+                return true;
+            }
+        }
+        m_high = high;
+        if (angle > m_max) m_max = angle;
+        if (angle < m_min) m_min = angle;
+
+        output = clampTo(m_bias + (high ? m_settings.relay : -m_settings.relay), m_settings.outputLimit);
+        return true;
+    }
+
+    // VERIFY
+    float direction = m_settings.step >= 0 ? 1.0f : -1.0f;
+    float past = (angle - m_target) * direction;
+    if (past > m_peak) m_peak = past;
+    if (fabsf(angle - m_target) > SETTLE_BAND * fabsf(m_settings.step)) m_lastOutsideUs = nowUs;
+
+    float verifyElapsed = (nowUs - m_startUs) * 1e-6f;
+    if (verifyElapsed >= m_settings.verifyTime) {
+        m_result.overshoot = m_settings.step != 0 ? 100 * m_peak / fabsf(m_settings.step) : 0;
+        m_result.settlingTime = (m_lastOutsideUs - m_startUs) * 1e-6f;
+        // Still leaving the band near the end of the window: not settled
+        m_result.settled = m_result.settlingTime < 0.9f * m_settings.verifyTime;
+        if (!m_result.settled) m_result.settlingTime = m_settings.verifyTime;
+        m_state = DONE;
+        return false;
+    }
+    output = m_pid.compute(angle, nowUs);
+    return true;
+}
+
+void Autotuner::finishRelay(uint32_t nowUs) {
+    int n = m_settings.cycles;
+    float tu = m_periodSum / n;
+    float a = m_amplitudeSum / n;
+    // The hysteresis delays each switch; take it out of the amplitude
+    float h = m_settings.hysteresis;
+    float effective = a > h ? sqrtf(a * a - h * h) : a;
+    float ku = 4 * m_settings.relay / (PI_F * effective);
+
+    float kp, ti, td;
+    switch (m_settings.rule) {
+    case ZIEGLER_NICHOLS:
+        kp = 0.6f * ku;
+        ti = 0.5f * tu;
+        td = 0.125f * tu;
+        break;
+    case NO_OVERSHOOT:
+        kp = 0.2f * ku;
+        ti = 0.5f * tu;
+        td = tu / 3;
+        break;
+    case ZIEGLER_NICHOLS_PI:
+        kp = 0.45f * ku;
+        ti = tu / 1.2f;
+        td = 0;
+        break;
+    case TYREUS_LUYBEN:
+    default:
+        kp = ku / 2.2f;
+        ti = 2.2f * tu;
+        td = tu / 6.3f;
+        break;
+    }
+
+    m_result.ku = ku;
+    m_result.tu = tu;
+    m_result.kp = kp;
+    m_result.ki = ti > 0 ? kp / ti : 0;
+    m_result.kd = kp * td;
+
+    m_pid.setP(m_result.kp);
+    m_pid.setI(m_result.ki);
+    m_pid.setD(m_result.kd);
+    m_pid.setOutputLimits(-m_settings.outputLimit, m_settings.outputLimit);
+    m_pid.setDerivativeFilter(m_settings.derivativeTau);
+    m_pid.reset();
+    // Start from the output that held the joint, as its own loop would
+    m_pid.setIntegral(m_bias);
+    m_target = m_center + m_settings.step;
+    m_pid.setSetpoint(m_target);
+
+    m_startUs = nowUs;
+    m_lastOutsideUs = nowUs;
+    m_peak = 0;
+    m_state = VERIFY;
+}
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <stdint.h>
+
+#include "PID/PID.h"
+
+// Relay-feedback autotuner for one joint's position PID (Astrom-Hagglund).
+//
+// RELAY: the joint is driven with bias +/- relay duty around the angle it was
+// at, switching with a little hysteresis, until it settles into a limit
+// cycle. Its period is the ultimate period Tu and its amplitude a gives the
+// ultimate gain Ku = 4 relay / (pi a). The selected rule turns Ku, Tu into
+// gains.
+// VERIFY: the candidate gains run a step of `step` deg from the same angle,
+// their integral starting at the relay bias, and overshoot and settling time
+// are measured.
+// DONE: the result waits to be applied; the joint's own gains are untouched.
+//
+// Runs inside the control task: step() is called for every joint on every
+// control step. start() and abort() may be called from any task and are
+// picked up at the next step.
+class Autotuner
+{
+public:
+    enum Rule : uint8_t
+    {
+        ZIEGLER_NICHOLS, // classic PID: fast, ~25% overshoot
+        TYREUS_LUYBEN,   // conservative PID, little overshoot
+        NO_OVERSHOOT,    // PID for no overshoot
+        ZIEGLER_NICHOLS_PI
+    };
+
+    enum State : uint8_t { IDLE, RELAY, VERIFY, DONE, FAILED };
+
+    struct Settings
+    {
+        Rule rule = TYREUS_LUYBEN;
+        float relay = 60;          // duty either side of the bias
+        float hysteresis = 0.5f;   // deg
+        int cycles = 4;            // limit cycles averaged, after one to settle
+        float step = 10;           // deg, verification step
+        float verifyTime = 3;      // s
+        float maxDeviation = 45;   // deg from the start angle before giving up
+        float timeout = 20;        // s for the relay phase
+        float outputLimit = 255;   // duty
+        float derivativeTau = 0;   // s, D filter for the verification run
+    };
+
+    struct Result
+    {
+        float ku;           // duty per deg
+        float tu;           // s
+        float kp;
+        float ki;
+        float kd;
+        float overshoot;    // % of the step
+        float settlingTime; // s into the 2% band (verifyTime if never)
+        bool settled;
+    };
+
+    Autotuner();
+
+    // False while a run is in progress
+    bool start(int joint, const Settings &settings);
+    void abort() { m_abortRequested = true; }
+
+    // While the tuner drives joint, returns true and sets output. On entry
+    // output is what the joint's own controller wants, which becomes the
+    // relay bias at the start (e.g. the I-term holding the arm up).
+    bool step(int joint, float angle, uint32_t nowUs, float &output);
+
+    State state() const { return m_state; }
+    int joint() const { return m_joint; }
+    bool running() const { return m_state == RELAY || m_state == VERIFY; }
+    float target() const { return m_target; }
+    const Result &result() const { return m_result; }
+    const char *failure() const { return m_failure; }
+
+private:
+    void fail(const char *reason);
+    void finishRelay(uint32_t nowUs);
+
+    PID<float> m_pid;
+    Settings m_settings;
+    Result m_result;
+
+    volatile State m_state;
+    volatile bool m_startRequested;
+    volatile bool m_abortRequested;
+    volatile int m_joint;
+    const char *m_failure;
+
+    uint32_t m_startUs;
+    float m_center;
+    float m_bias;
+    float m_target;
+    bool m_high;
+
+    int m_cycle;
+    uint32_t m_cycleStartUs;
+    float m_max;
+    float m_min;
+    float m_periodSum;
+    float m_amplitudeSum;
+
+    float m_peak;
+    uint32_t m_lastOutsideUs;
+};
@@ -0,0 +1,128 @@
+#include "Capture.h"
+
+#include <math.h>
+#include <string.h>
+
+// Reference moves smaller than this are not a setpoint change
+static const float SETPOINT_EPSILON = 1e-3f;
+
+Capture::Capture():
+    m_ring(), m_written(0), m_remaining(0), m_first(0), m_count(0), m_keptPre(0), m_prevSetpoint(),
+    m_state(IDLE), m_armRequest(false), m_triggerRequest(0),
+    m_requestTriggers(0), m_requestPre(0), m_requestError(0),
+    m_triggers(0), m_pre(0), m_errorThreshold(0), m_cause(0) {}
+
+void Capture::arm(uint8_t triggers, uint32_t pre, float errorThreshold) {
+    m_requestTriggers = triggers;
+    m_requestPre = pre < CAPACITY ? pre : CAPACITY - 1;
+    m_requestError = errorThreshold;
+    m_armRequest = true;
+}
+
+void Capture::trigger(Trigger cause) {
+    m_triggerRequest = cause;
+}
+
+void Capture::record(const TickRecord &tick) {
+    State state = m_state.load(std::memory_order_relaxed);
+
+    if (m_armRequest) {
+        m_triggers = m_requestTriggers;
+        m_pre = m_requestPre;
+        m_errorThreshold = m_requestError;
+        m_written = 0;
+        m_cause = 0;
+        m_triggerRequest = 0;
+        m_armRequest = false;
+        state = ARMED;
+        m_state.store(ARMED, std::memory_order_relaxed);
+    }
+    if (state == IDLE || state == DONE) return;
+
+    m_ring[m_written % CAPACITY] = tick;
+    m_written++;
+
+    if (state == ARMED) {
+        uint8_t cause = m_triggerRequest & (m_triggers | MANUAL);
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            const JointTick &jt = tick.joint[j];
+            if ((m_triggers & SETPOINT_CHANGE) && m_written > 1 &&
+                fabsf(angleError(j, jt.setpoint, m_prevSetpoint[j])) > SETPOINT_EPSILON) cause |= SETPOINT_CHANGE;
+            if ((m_triggers & TRACKING_ERROR) && fabsf(angleError(j, jt.setpoint, jt.angle)) > m_errorThreshold) cause |= TRACKING_ERROR;
+            m_prevSetpoint[j] = jt.setpoint;
+        }
+        if (!cause) return;
+
+        m_cause = cause;
+        m_keptPre = m_written - 1 < m_pre ? m_written - 1 : m_pre;
+        m_first = m_written - 1 - m_keptPre;
+        m_count = m_keptPre + CAPACITY - m_pre;
+        m_remaining = CAPACITY - m_pre - 1;
+        if (m_remaining == 0) {
+            m_state.store(DONE, std::memory_order_release);
+            return;
+        }
+        m_state.store(TRIGGERED, std::memory_order_relaxed);
+    } else if (--m_remaining == 0) {
+        m_state.store(DONE, std::memory_order_release);
+    }
+}
+
+static uint8_t *put(uint8_t *p, const void *value, size_t len) {
+    memcpy(p, value, len); // both targets are little-endian
+    return p + len;
+}
+
+void Capture::packRecord(uint8_t *buf, uint32_t n) const {
+    const TickRecord &tick = m_ring[(m_first + n) % CAPACITY];
+    uint8_t *p = put(buf, &tick.timeUs, 4);
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        const JointTick &jt = tick.joint[j];
+        p = put(p, &jt.counts, 4);
+        p = put(p, &jt.angle, 4);
+        p = put(p, &jt.setpoint, 4);
+        p = put(p, &jt.velocity, 4);
+        p = put(p, &jt.p, 4);
+        p = put(p, &jt.i, 4);
+        p = put(p, &jt.d, 4);
+        p = put(p, &jt.duty, 2);
+    }
+}
+
+size_t Capture::read(uint8_t *buf, size_t maxLen, size_t index) const {
+    size_t total = size();
+    if (index >= total) return 0;
+    if (maxLen > total - index) maxLen = total - index;
+
+    uint8_t header[HEADER_SIZE];
+    uint16_t count = m_count;
+    uint16_t pre = m_keptPre;
+    header[0] = VERSION;
+    header[1] = JOINT_COUNT;
+    header[2] = m_cause;
+    header[3] = 0;
+    put(header + 4, &count, 2);
+    put(header + 6, &pre, 2);
+
+    uint8_t record[RECORD_SIZE];
+    size_t done = 0;
+    while (done < maxLen) {
+        size_t at = index + done;
+        const uint8_t *src;
+        size_t offset;
+        if (at < HEADER_SIZE) {
+            src = header;
+            offset = at;
+        } else {
+            uint32_t n = (at - HEADER_SIZE) / RECORD_SIZE;
+            packRecord(record, n);
+            src = record;
+            offset = (at - HEADER_SIZE) % RECORD_SIZE;
+        }
+        size_t len = (src == header ? HEADER_SIZE : RECORD_SIZE) - offset;
+        if (len > maxLen - done) len = maxLen - done;
+        memcpy(buf + done, src + offset, len);
+        done += len;
+    }
+    return done;
+}
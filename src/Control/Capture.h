@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ControlLoop.h"
+
+// Triggered recorder for every control tick, like a scope in normal mode.
+// record() is called by the control task after each step and only copies
+// the TickRecord into a preallocated ring and checks the triggers, so it can
+// stay on all the time. Once armed and triggered it keeps up to `pre` ticks
+// from before the trigger (fewer if it triggers sooner after arming), records
+// CAPACITY - pre more and freezes until re-armed.
+//
+// Everything but record() may be called from other tasks: arm() and trigger()
+// are picked up by the next record(), and the buffer is only read once it is
+// DONE, when the control task no longer writes it.
+//
+// Download, little-endian:
+//   header  u8 version (1), u8 joints (2), u8 cause, u8 reserved, u16 count, u16 pre
+//   record  u32 timeUs, per joint: i32 counts, f32 angle, setpoint, velocity, p, i, d, i16 duty
+class Capture
+{
+public:
+    static const uint32_t CAPACITY = 512;
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 8;
+    static const size_t JOINT_SIZE = 4 + 6 * 4 + 2;
+    static const size_t RECORD_SIZE = 4 + JOINT_COUNT * JOINT_SIZE;
+
+    // Trigger sources, or-ed together in arm(); also the recorded cause
+    enum Trigger : uint8_t
+    {
+        SETPOINT_CHANGE = 1, // reference of any joint moves
+        TRACKING_ERROR = 2,  // |setpoint - angle| of any joint above the threshold
+        EMERGENCY_STOP = 4,  // via trigger()
+        MANUAL = 8           // via trigger(), always enabled
+    };
+
+    enum State : uint8_t { IDLE, ARMED, TRIGGERED, DONE };
+
+    Capture();
+
+    void arm(uint8_t triggers, uint32_t pre, float errorThreshold);
+    void trigger(Trigger cause);
+    void record(const TickRecord &tick);
+
+    State state() const { return m_state.load(std::memory_order_acquire); }
+    uint8_t cause() const { return m_cause; }
+    // Ticks kept in the capture, 0 until DONE
+    uint32_t count() const { return state() == DONE ? m_count : 0; }
+    uint32_t pre() const { return m_keptPre; }
+    size_t size() const { return HEADER_SIZE + count() * RECORD_SIZE; }
+
+    // Serialise bytes [index, index + maxLen) of a DONE capture into buf, for
+    // chunked responses; returns the number of bytes written.
+    size_t read(uint8_t *buf, size_t maxLen, size_t index) const;
+
+private:
+    void packRecord(uint8_t *buf, uint32_t n) const;
+
+    TickRecord m_ring[CAPACITY];
+    uint32_t m_written;   // total ticks written since arming
+    uint32_t m_remaining; // ticks still to record after the trigger
+    uint32_t m_first;     // m_written of the oldest tick kept
+    uint32_t m_count;     // ticks kept
+    uint16_t m_keptPre;   // of which before the trigger
+    float m_prevSetpoint[JOINT_COUNT];
+
+    std::atomic<State> m_state;
+    volatile bool m_armRequest;
+    volatile uint8_t m_triggerRequest;
+    volatile uint8_t m_requestTriggers;
+    volatile uint32_t m_requestPre;
+    volatile float m_requestError;
+
+    uint8_t m_triggers;
+    uint32_t m_pre;
+    float m_errorThreshold;
+    uint8_t m_cause;
+};
@@ -0,0 +1,48 @@
+#include "Commands.h"
+
+#include <math.h>
+#include <string.h>
+
+#include "Joints.h"
+
+static int valueCount(uint8_t type) {
+    switch (type) {
+    case Command::SETPOINT: return 1;
+    case Command::GAINS:
+    case Command::LIMITS: return 3;
+    case Command::MODE:
+    case Command::ESTOP: return 0;
+    default: return -1;
+    }
+}
+
+CommandProtocol::Status CommandProtocol::decode(const uint8_t *data, size_t len, Command &cmd) {
+    memset(&cmd, 0, sizeof(cmd));
+    if (len < 4) return BAD_LENGTH;
+    cmd.type = data[1];
+    memcpy(&cmd.seq, data + 2, 2); // both targets are little-endian
+    if (data[0] != VERSION) return BAD_VERSION;
+
+    int n = valueCount(cmd.type);
+    if (n < 0) return BAD_TYPE;
+    if (len != HEADER_SIZE + 4 * (size_t)n) return BAD_LENGTH;
+
+    cmd.joint = data[4];
+    cmd.option = data[5];
+    memcpy(cmd.value, data + HEADER_SIZE, 4 * n);
+
+    if (cmd.joint >= JOINT_COUNT) return BAD_VALUE;
+    for (int k = 0; k < n; k++) {
+        if (!isfinite(cmd.value[k])) return BAD_VALUE;
+    }
+    return OK;
+}
+
+size_t CommandProtocol::encodeAck(uint8_t *buf, const Command &cmd, Status status) {
+    buf[0] = VERSION;
+    buf[1] = ACK | cmd.type;
+    memcpy(buf + 2, &cmd.seq, 2);
+    buf[4] = status;
+    buf[5] = 0;
+    return ACK_SIZE;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// One decoded command from the binary command protocol.
+struct Command
+{
+    enum Type : uint8_t
+    {
+        SETPOINT = 1, // value[0] = target angle, deg
+        GAINS = 2,    // option = loop (0 position, 1 velocity), value = P, I, D
+        LIMITS = 3,   // option = shape (0 trapezoidal, 1 S-curve), value = v, a, j
+        MODE = 4,     // option = ControlLoop::Mode
+        ESTOP = 5
+    };
+
+    uint8_t type;
+    uint16_t seq;
+    uint8_t joint;
+    uint8_t option;
+    float value[3];
+};
+
+// Framed binary commands, sent as single WebSocket binary messages. Decoding
+// works in place on the received bytes, with no allocation.
+//
+// Command, little-endian:
+//   u8 version (1), u8 type, u16 seq, u8 joint, u8 option, f32 value[n]
+// where n is 1 for SETPOINT, 3 for GAINS and LIMITS, 0 otherwise.
+// Every command is answered with an ack:
+//   u8 version (1), u8 ACK | type, u16 seq, u8 status, u8 reserved
+class CommandProtocol
+{
+public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t ACK = 0x80;
+    static const size_t HEADER_SIZE = 6;
+    static const size_t ACK_SIZE = 6;
+
+    enum Status : uint8_t { OK, BAD_VERSION, BAD_TYPE, BAD_LENGTH, BAD_VALUE };
+
+    // Fills cmd as far as the frame allows (seq and type for the ack even
+    // when the rest is malformed) and reports whether it is valid.
+    static Status decode(const uint8_t *data, size_t len, Command &cmd);
+
+    static size_t encodeAck(uint8_t *buf, const Command &cmd, Status status);
+};
@@ -0,0 +1,288 @@
+#include "ControlLoop.h"
+
+#include <math.h>
+
+ControlLoop::ControlLoop(Acquisition &acquisition, Motor *const *motors, Clock &clock):
+    velocityFF(), m_acquisition(acquisition), m_clock(clock), m_state(), m_tick(),
+    m_mode(), m_requestedMode(), m_modeChanged(),
+    m_maxVelocity(DEFAULT_MAX_VELOCITY), m_outerDivider(DEFAULT_OUTER_DIVIDER), m_outerCount(), m_outerOutput(),
+    m_tuning(), m_gains(), m_gainsChanged(), m_resetRequested(), m_limits(), m_shape(), m_profileChanged(),
+    m_target(), m_move(), m_direct(), m_stopRequested(false), m_stopped(),
+    m_cartesianTarget(), m_cartesianSpeed(0), m_cartesianMove(false), m_cartesian(false),
+    m_lineStart(), m_lineEnd(), m_lineStartUs(0), m_lineDuration(0), m_prevUs(0), m_cartesianFailures(0) {
+    for (int j = 0; j < JOINT_COUNT; j++) driver[j].attach(motors[j]);
+}
+
+void ControlLoop::begin() {
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        positionPid[j].setDerivativeFilter(DERIVATIVE_TAU);
+        if (jointWraps(j)) positionPid[j].setWrap(360.0f);
+        velocityPid[j].setOutputLimits(-MAX_DUTY, MAX_DUTY);
+        velocityPid[j].setDerivativeFilter(DERIVATIVE_TAU);
+        applyMode(j);
+        driver[j].begin();
+    }
+}
+
+void ControlLoop::moveTo(int joint, float angle) {
+    m_target[joint] = angle;
+    m_direct[joint] = false;
+    m_move[joint] = true;
+}
+
+void ControlLoop::track(int joint, float angle) {
+    m_target[joint] = angle;
+    m_direct[joint] = true;
+    m_move[joint] = true;
+}
+
+bool ControlLoop::moveToCartesian(float x, float y, float speed) {
+    JointState state = m_acquisition.latest();
+    // Seeded like sampleCartesian(), so both pick the same branch
+    float arm = apiAngle(0, state.angle[0]);
+    float wrist = apiAngle(1, state.angle[1]);
+    if (speed <= 0 || !kinematics.inverse({x, y}, arm, wrist)) return false;
+    m_cartesianTarget[0] = x;
+    m_cartesianTarget[1] = y;
+    m_cartesianSpeed = speed;
+    m_cartesianMove = true;
+    return true;
+}
+
+// From the current arm/wrist setpoints, so the line starts without a jump
+void ControlLoop::startCartesian(const MotionProfile::Point *refs) {
+    m_lineStart = kinematics.forward(refs[0].pos, refs[1].pos);
+    m_lineEnd = PlanarArm<>::Point{m_cartesianTarget[0], m_cartesianTarget[1]};
+    float dx = m_lineEnd.x - m_lineStart.x;
+    float dy = m_lineEnd.y - m_lineStart.y;
+    m_lineDuration = sqrtf(dx * dx + dy * dy) / m_cartesianSpeed;
+    m_lineStartUs = m_state.timeUs;
+    m_prevUs = m_state.timeUs;
+    m_cartesian = true;
+    trajectory.stop();
+}
+
+// Overwrites the arm/wrist references with the IK of the next point on the
+// line; the profiles follow so they hold wherever the line ends.
+void ControlLoop::sampleCartesian(MotionProfile::Point *refs) {
+    float t = (m_state.timeUs - m_lineStartUs) * 1e-6f;
+    float s = m_lineDuration > 0 && t < m_lineDuration ? t / m_lineDuration : 1.0f;
+    PlanarArm<>::Point p = {m_lineStart.x + s * (m_lineEnd.x - m_lineStart.x),
+                            m_lineStart.y + s * (m_lineEnd.y - m_lineStart.y)};
+
+    float arm = apiAngle(0, refs[0].pos);
+    float wrist = apiAngle(1, refs[1].pos);
+    if (!kinematics.inverse(p, arm, wrist)) {
+        m_cartesian = false;
+        m_cartesianFailures++;
+        return;
+    }
+    float dt = (m_state.timeUs - m_prevUs) * 1e-6f;
+    m_prevUs = m_state.timeUs;
+    float ik[2] = {arm, wrist};
+    for (int j = 0; j < 2; j++) {
+        float move = angleError(j, ik[j], refs[j].pos);
+        refs[j].vel = dt > 0 ? move / dt : 0;
+        refs[j].acc = 0;
+        refs[j].pos += move;
+        profile[j].reset(refs[j].pos);
+    }
+    if (s >= 1.0f) m_cartesian = false;
+}
+
+void ControlLoop::setMode(int joint, Mode mode) {
+    m_requestedMode[joint] = mode;
+    m_modeChanged[joint] = true;
+}
+
+void ControlLoop::setCascade(float maxVelocity, int outerDivider) {
+    m_maxVelocity = maxVelocity;
+    m_outerDivider = outerDivider < 1 ? 1 : outerDivider;
+    for (int j = 0; j < JOINT_COUNT; j++) m_modeChanged[j] = true;
+}
+
+void ControlLoop::setGains(int joint, bool velocity, float p, float i, float d) {
+    m_gains[joint][velocity][0] = p;
+    m_gains[joint][velocity][1] = i;
+    m_gains[joint][velocity][2] = d;
+    m_gainsChanged[joint][velocity] = true;
+}
+
+void ControlLoop::resetLoops(int joint) {
+    m_resetRequested[joint] = true;
+}
+
+void ControlLoop::setProfile(int joint, float maxVelocity, float maxAcceleration, float maxJerk,
+                             MotionProfile::Shape shape) {
+    m_limits[joint][0] = maxVelocity;
+    m_limits[joint][1] = maxAcceleration;
+    m_limits[joint][2] = maxJerk;
+    m_shape[joint] = shape;
+    m_profileChanged[joint] = true;
+}
+
+bool ControlLoop::startAutotune(int joint, const Autotuner::Settings &settings) {
+    if (joint < 0 || joint >= JOINT_COUNT) return false;
+    if (m_mode[joint] == CASCADE || m_requestedMode[joint] == CASCADE) return false;
+    Autotuner::Settings s = settings;
+    s.outputLimit = MAX_DUTY;
+    s.derivativeTau = DERIVATIVE_TAU;
+    return autotune.start(joint, s);
+}
+
+// While the autotuner drives a joint its output replaces the PID's; when it
+// lets go the joint holds where it is.
+bool ControlLoop::tune(int joint, float &output) {
+    float angle = m_state.angle[joint];
+    bool tuning = autotune.step(joint, angle, m_state.timeUs, output);
+    if (m_tuning[joint] && !tuning) {
+        profile[joint].reset(angle);
+        positionPid[joint].reset();
+    }
+    m_tuning[joint] = tuning;
+    return tuning;
+}
+
+// Settings other tasks asked for since the last step
+void ControlLoop::applyRequests(int joint) {
+    for (int loop = 0; loop < 2; loop++) {
+        if (!m_gainsChanged[joint][loop]) continue;
+        m_gainsChanged[joint][loop] = false;
+        PID<float> &pid = loop ? velocityPid[joint] : positionPid[joint];
+        pid.setP(m_gains[joint][loop][0]);
+        pid.setI(m_gains[joint][loop][1]);
+        pid.setD(m_gains[joint][loop][2]);
+    }
+    if (m_resetRequested[joint]) {
+        m_resetRequested[joint] = false;
+        positionPid[joint].reset();
+        velocityPid[joint].reset();
+    }
+    if (m_profileChanged[joint]) {
+        m_profileChanged[joint] = false;
+        profile[joint].setLimits(m_limits[joint][0], m_limits[joint][1], m_limits[joint][2]);
+        profile[joint].setShape(m_shape[joint]);
+    }
+}
+
+void ControlLoop::applyMode(int joint) {
+    m_mode[joint] = m_requestedMode[joint];
+    if (m_mode[joint] == CASCADE) positionPid[joint].setOutputLimits(-m_maxVelocity, m_maxVelocity);
+    else positionPid[joint].setOutputLimits(-MAX_DUTY, MAX_DUTY);
+    positionPid[joint].reset();
+    velocityPid[joint].reset();
+    m_outerCount[joint] = 0;
+    m_outerOutput[joint] = 0;
+}
+
+float ControlLoop::output(int joint, const MotionProfile::Point &ref) {
+    PID<float> &position = positionPid[joint];
+    float feedForward = velocityFF[joint] * ref.vel;
+    position.setSetpoint(ref.pos);
+    if (m_mode[joint] == POSITION) return position.compute(m_state.angle[joint], m_state.timeUs, feedForward);
+
+    if (m_outerCount[joint] == 0) m_outerOutput[joint] = position.compute(m_state.angle[joint], m_state.timeUs);
+    if (++m_outerCount[joint] >= m_outerDivider) m_outerCount[joint] = 0;
+
+    velocityPid[joint].setSetpoint(m_outerOutput[joint] + ref.vel);
+    return velocityPid[joint].compute(m_state.velocity[joint], m_state.timeUs, feedForward);
+}
+
+void ControlLoop::step() {
+    unsigned long now = m_clock.micros();
+
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        applyRequests(j);
+        if (!m_modeChanged[j]) continue;
+        m_modeChanged[j] = false;
+        applyMode(j);
+    }
+
+    m_state = m_acquisition.latest();
+    bool fresh = (long)(now - m_state.timeUs) < (long)STALE_US;
+
+    // An e-stop drops whatever motion is planned or pending and parks every
+    // profile on the measured angle; the motors stay off until a new command
+    if (m_stopRequested) {
+        m_stopRequested = false;
+        m_cartesianMove = false;
+        m_cartesian = false;
+        trajectory.stop();
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            m_move[j] = false;
+            m_stopped[j] = true;
+            profile[j].reset(m_state.angle[j]);
+            positionPid[j].reset();
+            velocityPid[j].reset();
+            m_outerCount[j] = 0;
+            m_outerOutput[j] = 0;
+        }
+    }
+
+    MotionProfile::Point refs[JOINT_COUNT];
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        if (m_move[j]) {
+            m_move[j] = false;
+            m_stopped[j] = false;
+            m_cartesian = false;
+            trajectory.stop();
+            // Tracked setpoints skip planning. A joint at rest on the target
+            // already holds it; re-planning from the measured angle would
+            // only nudge the setpoint
+            float target = nearestTarget(j, m_target[j], m_state.angle[j]);
+            if (m_direct[j]) profile[j].reset(target);
+            else if (!profile[j].done()) profile[j].moveTo(target, m_state.timeUs);
+            else if (target != profile[j].target()) {
+                profile[j].reset(m_state.angle[j]);
+                profile[j].moveTo(target, m_state.timeUs);
+            }
+        }
+        refs[j] = profile[j].sample(m_state.timeUs);
+    }
+    if (m_cartesianMove) {
+        m_cartesianMove = false;
+        startCartesian(refs);
+        for (int j = 0; j < JOINT_COUNT; j++) m_stopped[j] = false;
+    }
+    if (trajectory.sample(m_state.timeUs, refs)) {
+        m_cartesian = false;
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            profile[j].reset(refs[j].pos);
+            m_stopped[j] = false;
+        }
+    }
+    if (m_cartesian) sampleCartesian(refs);
+
+    // Each PID times itself from the sample timestamp
+    m_tick.timeUs = m_state.timeUs;
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        uint32_t start = m_clock.cycles();
+        float out = m_stopped[j] ? 0 : output(j, refs[j]);
+        bool tuning = tune(j, out);
+        if (tuning) m_stopped[j] = false;
+        uint32_t computed = m_clock.cycles();
+        float duty = driver[j].write(fresh && m_state.valid[j] ? out : 0);
+        pidTime[j].record(computed - start);
+        driveTime[j].record(m_clock.cycles() - computed);
+
+        record(m_tick.joint[j], j, m_state.counts[j], m_state.angle[j], tuning ? autotune.target() : refs[j].pos,
+               m_state.velocity[j], m_mode[j] == CASCADE ? velocityPid[j] : positionPid[j], duty);
+    }
+}
+
+void ControlLoop::record(JointTick &tick, int joint, int32_t counts, float angle, float setpoint, float velocity,
+                         const PID<float> &pid, float duty) {
+    tick.counts = counts;
+    tick.angle = apiAngle(joint, angle);
+    tick.setpoint = apiAngle(joint, setpoint);
+    tick.velocity = velocity;
+    tick.p = pid.pTerm();
+    tick.i = pid.iTerm();
+    tick.d = pid.dTerm();
+    tick.duty = (int16_t)lroundf(duty);
+}
+
+void ControlLoop::stop() {
+    autotune.abort();
+    m_stopRequested = true;
+}
@@ -0,0 +1,172 @@
+#pragma once
+
+#include "HAL/HAL.h"
+#include "PID/PID.h"
+#include "Acquisition.h"
+#include "Angle.h"
+#include "Autotune.h"
+#include "Kinematics.h"
+#include "MotionProfile.h"
+#include "MotorDriver.h"
+#include "Trajectory.h"
+
+// What one step did to one joint, for telemetry and capture.
+struct JointTick
+{
+    int32_t counts; // raw sensor counts
+    float angle;    // deg, as measured (filtered)
+    float setpoint; // deg
+    float velocity; // deg/s, filter estimate (0 where there is none)
+    float p;        // terms of the PID that drives the output
+    float i;
+    float d;
+    int16_t duty;   // signed duty applied after shaping, rounded
+};
+
+struct TickRecord
+{
+    uint32_t timeUs; // sample time the step acted on
+    JointTick joint[JOINT_COUNT];
+};
+
+// Joint controller: takes the latest JointState from Acquisition, runs one
+// pass over the joints (PIDs, motor drivers) per step. Knows nothing about the
+// platform beyond the HAL interfaces, so the same code runs on the ESP32 and
+// in the native build.
+//
+// Any joint can run cascaded: its position loop becomes the outer loop
+// producing a velocity setpoint every outerDivider steps, and its velocity
+// loop closes an inner loop on the Kalman velocity estimate every step.
+//
+// Setpoints come from a MotionProfile per joint: moveTo() plans a move, and
+// every step the profile position becomes the PID setpoint and its velocity
+// the feed-forward (times velocityFF, in duty per deg/s; in cascade mode it
+// is also added to the velocity setpoint). While an uploaded trajectory is
+// playing it takes the profiles' place, and the profiles follow it so they
+// continue from where it ends.
+//
+// A Cartesian move does the same for the arm and wrist: the tool tip moves
+// along a straight line at constant speed and IK is re-solved every step.
+class ControlLoop
+{
+public:
+    static constexpr int MAX_DUTY = (int)MotorDriver::MAX_DUTY;
+    static constexpr unsigned long STALE_US = 100000; // motors off if the sample is older
+    static constexpr float DERIVATIVE_TAU = 0.005f;    // s, D-term low-pass
+
+    enum Mode { POSITION, CASCADE };
+
+    static constexpr float DEFAULT_MAX_VELOCITY = 180.0f; // deg/s, outer loop output limit
+    static constexpr int DEFAULT_OUTER_DIVIDER = 5;
+
+    // One motor per entry of JOINTS
+    ControlLoop(Acquisition &acquisition, Motor *const *motors, Clock &clock);
+
+    void begin();
+    void step();
+    // Emergency stop, safe from any task: at the next step() the autotuner,
+    // trajectory and moves are dropped, the profiles park on the measured
+    // angles and the motors are held off until the joint is commanded again.
+    void stop();
+
+    // The move starts at the next step(), from the profile's current
+    // position, velocity and acceleration, or from the measured angle if the
+    // joint is at rest; joints that turn freely take the short way round.
+    // Commanding the target already planned or held changes nothing, so a
+    // stream may repeat it. A move stops trajectory playback.
+    void moveTo(int joint, float angle);
+    // For streamed setpoints (teleop): the angle becomes the setpoint at the
+    // next step(), unplanned and without feed-forward, as the stream is
+    // already smooth. Cancels moves and playback like moveTo().
+    void track(int joint, float angle);
+    // Straight tool-tip line from where the setpoints are to (x, y) in mm, at
+    // speed mm/s. False if the target is out of reach from the measured
+    // pose; a point on the way that is out of reach ends the move there.
+    // moveTo() or a trajectory cancel it.
+    bool moveToCartesian(float x, float y, float speed);
+    bool cartesianActive() const { return m_cartesian; }
+    uint32_t cartesianFailures() const { return m_cartesianFailures; }
+
+    // Applied at the start of the next step(); the joint's loops are reset.
+    void setMode(int joint, Mode mode);
+    void setCascade(float maxVelocity, int outerDivider);
+    // Also applied at the start of the next step(), so other tasks never
+    // touch a PID or profile mid-step: gains of the position or (velocity)
+    // inner loop, clearing both loops' state, profile limits and shape.
+    void setGains(int joint, bool velocity, float p, float i, float d);
+    void resetLoops(int joint);
+    void setProfile(int joint, float maxVelocity, float maxAcceleration, float maxJerk, MotionProfile::Shape shape);
+    Mode mode(int joint) const { return m_mode[joint]; }
+
+    // Relay autotune of a joint's position loop; false if one is already
+    // running or the joint is in cascade mode. The joint holds where it ends
+    // up once the run is over.
+    bool startAutotune(int joint, const Autotuner::Settings &settings);
+
+    const TickRecord &lastTick() const { return m_tick; }
+
+    float angle(int joint) const { return apiAngle(joint, m_state.angle[joint]); }
+
+    PID<float> positionPid[JOINT_COUNT];
+    PID<float> velocityPid[JOINT_COUNT];   // inner loop in cascade mode
+    MotionProfile profile[JOINT_COUNT];
+    float velocityFF[JOINT_COUNT];
+    MotorDriver driver[JOINT_COUNT];
+
+    // Per joint: the PIDs (and autotuner) and the motor driver write
+    CycleHistogram pidTime[JOINT_COUNT];
+    CycleHistogram driveTime[JOINT_COUNT];
+
+    TrajectoryPlayer trajectory;
+    Autotuner autotune;
+    const PlanarArm<> kinematics;
+
+private:
+    Acquisition &m_acquisition;
+    Clock &m_clock;
+
+    JointState m_state;
+    TickRecord m_tick;
+
+    void applyRequests(int joint);
+    void applyMode(int joint);
+    float output(int joint, const MotionProfile::Point &ref);
+    bool tune(int joint, float &output);
+    void startCartesian(const MotionProfile::Point *refs);
+    void sampleCartesian(MotionProfile::Point *refs);
+    static void record(JointTick &tick, int joint, int32_t counts, float angle, float setpoint, float velocity,
+                       const PID<float> &pid, float duty);
+
+    Mode m_mode[JOINT_COUNT];
+    volatile Mode m_requestedMode[JOINT_COUNT];
+    volatile bool m_modeChanged[JOINT_COUNT];
+    float m_maxVelocity;
+    int m_outerDivider;
+    int m_outerCount[JOINT_COUNT];
+    float m_outerOutput[JOINT_COUNT];
+    bool m_tuning[JOINT_COUNT];
+
+    volatile float m_gains[JOINT_COUNT][2][3];   // [joint][velocity loop][p, i, d]
+    volatile bool m_gainsChanged[JOINT_COUNT][2];
+    volatile bool m_resetRequested[JOINT_COUNT];
+    volatile float m_limits[JOINT_COUNT][3];     // deg/s, deg/s^2, deg/s^3
+    volatile MotionProfile::Shape m_shape[JOINT_COUNT];
+    volatile bool m_profileChanged[JOINT_COUNT];
+
+    volatile float m_target[JOINT_COUNT];
+    volatile bool m_move[JOINT_COUNT];
+    volatile bool m_direct[JOINT_COUNT];   // m_target is a track() setpoint
+    volatile bool m_stopRequested;
+    bool m_stopped[JOINT_COUNT];   // e-stopped, output held at 0
+
+    volatile float m_cartesianTarget[2];
+    volatile float m_cartesianSpeed;
+    volatile bool m_cartesianMove;
+    bool m_cartesian;
+    PlanarArm<>::Point m_lineStart;
+    PlanarArm<>::Point m_lineEnd;
+    uint32_t m_lineStartUs;
+    float m_lineDuration;   // s
+    uint32_t m_prevUs;
+    uint32_t m_cartesianFailures;
+};
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "ControlLoop.h"
+#include "Metrics.h"
+
+// The stages timed by the platform-independent control path, as series of
+// robotarm_stage_seconds. The caller writes the family header and may add
+// its own stages (bus lock, I2C transaction, web handlers) after these.
+template <typename Out>
+void writeControlStages(Out &out, const Acquisition &acquisition, const ControlLoop &control,
+                        uint64_t cyclesPerSecond)
+{
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        writeStage(out, "read", JOINTS[j].name, acquisition.readTime[j], cyclesPerSecond);
+        writeStage(out, "kf", JOINTS[j].name, acquisition.filterTime[j], cyclesPerSecond);
+        writeStage(out, "pid", JOINTS[j].name, control.pidTime[j], cyclesPerSecond);
+        writeStage(out, "pwm", JOINTS[j].name, control.driveTime[j], cyclesPerSecond);
+    }
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <math.h>
+#include <stdint.h>
+
+// Polynomial sin/cos/atan2 for the control task, in float, with no tables and
+// no libm calls. Bounds measured by bench_trig over the ranges used here:
+//   fastSinCos  |error| < 1e-7 for |x| < 8 pi (grows slowly with |x|
+//               through the range reduction)
+//   fastAtan2   |error| < 1.2e-5 rad (7e-4 deg, far below one AS5600 count)
+
+constexpr float FAST_PI = 3.14159265358979f;
+
+// sin(x) and cos(x) with one shared range reduction: x = j * pi/2 + r with
+// |r| <= pi/4, then Cephes' sinf/cosf kernels on r.
+inline void fastSinCos(float x, float &s, float &c)
+{
+    // pi/2 split in three so that j * part is exact for moderate j
+    const float PIO2_1 = 1.5703125f;
+    const float PIO2_2 = 4.837512969970703125e-4f;
+    const float PIO2_3 = 7.54978995489188216e-8f;
+
+    float k = x * (2.0f / FAST_PI);
+    int32_t q = (int32_t)(k + (k >= 0.0f ? 0.5f : -0.5f));
+    float j = (float)q;
+    float r = ((x - j * PIO2_1) - j * PIO2_2) - j * PIO2_3;
+    float z = r * r;
+
+    float sr = r + r * z * (-1.6666654611e-1f + z * (8.3321608736e-3f + z * -1.9515295891e-4f));
+    float cr = 1.0f - 0.5f * z + z * z * (4.166664568298827e-2f + z * (-1.388731625493765e-3f + z * 2.443315711809948e-5f));
+
+    // Quadrant j mod 4 swaps and negates; selects rather than a jump table
+    float ss = (q & 1) ? cr : sr;
+    float cc = (q & 1) ? sr : cr;
+    s = (q & 2) ? -ss : ss;
+    c = ((q + 1) & 2) ? -cc : cc;
+}
+
+inline float fastSin(float x)
+{
+    float s, c;
+    fastSinCos(x, s, c);
+    return s;
+}
+
+inline float fastCos(float x)
+{
+    float s, c;
+    fastSinCos(x, s, c);
+    return c;
+}
+
+// atan2(y, x) in (-pi, pi]: atan of min/max over [0, 1] from Abramowitz &
+// Stegun 4.4.49, then folded into the right octant. atan2(0, 0) is 0.
+inline float fastAtan2(float y, float x)
+{
+    float ax = fabsf(x);
+    float ay = fabsf(y);
+    float hi = ax > ay ? ax : ay;
+    if (hi == 0.0f) return 0.0f;
+    float t = (ax > ay ? ay : ax) / hi;
+    float t2 = t * t;
+    float a = t * (0.9998660f + t2 * (-0.3302995f + t2 * (0.1801410f + t2 * (-0.0851330f + t2 * 0.0208351f))));
+    if (ay > ax) a = 0.5f * FAST_PI - a;
+    if (x < 0.0f) a = FAST_PI - a;
+    return y < 0.0f ? -a : a;
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+// Everything that differs between joints, fixed at compile time. The control
+// path, the firmware setup and the web handlers all loop over JOINTS, so a
+// joint is added by adding a descriptor here (and a sim joint in the native
+// programs). Per-tick work is one pass over JOINT_COUNT joints.
+//
+// Pins are plain ESP32 GPIO numbers; the native build ignores them.
+struct JointDescriptor
+{
+    enum EncoderRead : uint8_t { ABSOLUTE, CUMULATIVE };
+
+    const char *name;       // web API / log name, e.g. joint=arm
+
+    // H-bridge: LEDC PWM on the enable pin, two direction GPIOs
+    int8_t pwmPin;
+    int8_t in1Pin;
+    int8_t in2Pin;
+    uint8_t ledcChannel;
+
+    // AS5600: index into I2C_BUSES. It has a fixed address, so one per bus.
+    uint8_t bus;
+    EncoderRead read;       // ABSOLUTE: 0..4095 per turn, CUMULATIVE: with full turns
+    float gearRatio;        // sensor turns per joint turn
+    float zeroOffset;       // deg added to the sensor angle before the gear
+    float sensorOffset;     // deg, default AS5600 offset until one is stored
+
+    float minAngle;         // deg, commanded setpoint range
+    float maxAngle;
+    float maxGains[3];      // P, I, D accepted by the position loop
+
+    float linkLength;       // mm, this joint's axis to the next one (or the tool tip)
+};
+
+struct I2CBusDescriptor
+{
+    int8_t sda;
+    int8_t scl;
+    uint32_t clockHz;   // 400 kHz fast mode; the AS5600 also does 1 MHz
+                        // (fast-mode plus) on short wires with ~1k pull-ups
+};
+
+constexpr I2CBusDescriptor I2C_BUSES[] = {
+    {16, 17, 400000},   // Wire
+    {21, 22, 400000},   // Wire1
+};
+
+constexpr JointDescriptor JOINTS[] = {
+    // Absolute sensor on the joint, shifted to -180..180 deg
+    {"arm",   25, 32, 33, 0, 0, JointDescriptor::ABSOLUTE,   1.0f, -180.0f, -33.0f,
+     -180.0f, 180.0f, {1000.0f, 1000.0f, 1.0f}, 150.0f},
+    // Sensor before the 4.5:1 wrist gear, counted across turns
+    {"wrist", 26, 18, 27, 1, 1, JointDescriptor::CUMULATIVE, 4.5f,    0.0f,   0.0f,
+     -180.0f, 180.0f, {100.0f, 100.0f, 100.0f}, 100.0f},
+};
+
+constexpr int JOINT_COUNT = sizeof(JOINTS) / sizeof(JOINTS[0]);
+
+// H-bridge PWM, every joint. Above hearing; LEDC counts the 80 MHz APB clock,
+// so 20 kHz leaves 4000 steps per period: 11 bits is the finest resolution
+// at this frequency. The sim motor quantises to the same resolution.
+constexpr int PWM_FREQUENCY_HZ = 20000;
+constexpr int PWM_RESOLUTION_BITS = 11;
+
+// Velocity loop gain limits (cascade mode), the same for every joint
+constexpr float MAX_VELOCITY_GAINS[3] = {100.0f, 1000.0f, 1.0f};
+
+// Index of the joint called name, or -1
+inline int jointIndex(const char *name)
+{
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        const char *a = JOINTS[j].name;
+        const char *b = name;
+        while (*a && *a == *b) a++, b++;
+        if (*a == *b) return j;
+    }
+    return -1;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <math.h>
+#include <initializer_list>
+
+#include "FastMath.h"
+#include "Joints.h"
+
+// Trig used by PlanarArm: libm for reference, the FastMath.h kernels for the
+// control task.
+struct LibmTrig
+{
+    static void sinCos(float x, float &s, float &c) { s = sinf(x); c = cosf(x); }
+    static float atan2(float y, float x) { return atan2f(y, x); }
+};
+
+struct FastTrig
+{
+    static void sinCos(float x, float &s, float &c) { fastSinCos(x, s, c); }
+    static float atan2(float y, float x) { return fastAtan2(y, x); }
+};
+
+// Forward and inverse kinematics of the first two joints as a planar chain:
+// the arm turns in the vertical plane from horizontal (arm angle 0 = link
+// pointing forward), the wrist relative to the arm. Positions are the tool
+// tip in mm, x forward and y up from the arm axis; angles in deg.
+template <typename Trig = FastTrig>
+class PlanarArm
+{
+public:
+    static_assert(JOINT_COUNT >= 2, "PlanarArm needs an arm and a wrist joint");
+
+    struct Point
+    {
+        float x;
+        float y;
+    };
+
+    PlanarArm() : m_l1(JOINTS[0].linkLength), m_l2(JOINTS[1].linkLength) {}
+    PlanarArm(float upper, float lower) : m_l1(upper), m_l2(lower) {}
+
+    Point forward(float arm, float wrist) const
+    {
+        float s1, c1, s12, c12;
+        Trig::sinCos(arm * DEG, s1, c1);
+        Trig::sinCos((arm + wrist) * DEG, s12, c12);
+        return Point{m_l1 * c1 + m_l2 * c12, m_l1 * s1 + m_l2 * s12};
+    }
+
+    // Of the two solutions (wrist bent either way), the one within the joint
+    // limits closest to the current angles arm/wrist, which it overwrites.
+    // False, leaving them untouched, if the point is out of reach or neither
+    // solution is within the limits.
+    bool inverse(Point target, float &arm, float &wrist) const
+    {
+        float r2 = target.x * target.x + target.y * target.y;
+        float c2 = (r2 - m_l1 * m_l1 - m_l2 * m_l2) / (2.0f * m_l1 * m_l2);
+        if (c2 < -1.0f || c2 > 1.0f) return false;
+        float s2 = sqrtf(1.0f - c2 * c2);
+        float base = Trig::atan2(target.y, target.x);
+
+        bool found = false;
+        float bestArm = 0, bestWrist = 0, bestCost = 0;
+        for (float sign : {1.0f, -1.0f}) {
+            float w = Trig::atan2(sign * s2, c2);
+            float a = wrap(base - Trig::atan2(m_l2 * sign * s2, m_l1 + m_l2 * c2));
+            w *= 1.0f / DEG;
+            if (!within(0, a) || !within(1, w)) continue;
+            float cost = (a - arm) * (a - arm) + (w - wrist) * (w - wrist);
+            if (!found || cost < bestCost) {
+                found = true;
+                bestArm = a;
+                bestWrist = w;
+                bestCost = cost;
+            }
+        }
+        if (!found) return false;
+        arm = bestArm;
+        wrist = bestWrist;
+        return true;
+    }
+
+    float reach() const { return m_l1 + m_l2; }
+
+private:
+    static constexpr float DEG = FAST_PI / 180.0f;
+
+    // rad to deg in -180..180
+    static float wrap(float rad)
+    {
+        if (rad > FAST_PI) rad -= 2.0f * FAST_PI;
+        else if (rad < -FAST_PI) rad += 2.0f * FAST_PI;
+        return rad * (1.0f / DEG);
+    }
+
+    static bool within(int joint, float angle)
+    {
+        return angle >= JOINTS[joint].minAngle && angle <= JOINTS[joint].maxAngle;
+    }
+
+    float m_l1;
+    float m_l2;
+};
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <stdint.h>
+#include <math.h>
+
+// Period/jitter/execution-time statistics of a fixed-rate loop. Written by the
+// loop itself, read by diagnostics; readers may see a torn update.
+struct LoopStats
+{
+    uint32_t nominalUs;
+    uint32_t count;
+    uint32_t minPeriodUs;
+    uint32_t maxPeriodUs;
+    uint64_t sumPeriodUs;
+    uint32_t maxJitterUs;   // max |period - nominal|
+    uint64_t sumSqJitterUs; // for RMS jitter
+    uint32_t maxExecUs;
+    uint64_t sumExecUs;
+    uint32_t overruns;      // executions longer than the nominal period
+
+    void reset(uint32_t nominal)
+    {
+        nominalUs = nominal;
+        count = 0;
+        minPeriodUs = UINT32_MAX;
+        maxPeriodUs = 0;
+        sumPeriodUs = 0;
+        maxJitterUs = 0;
+        sumSqJitterUs = 0;
+        maxExecUs = 0;
+        sumExecUs = 0;
+        overruns = 0;
+    }
+
+    void record(uint32_t periodUs, uint32_t execUs)
+    {
+        uint32_t jitter = periodUs > nominalUs ? periodUs - nominalUs : nominalUs - periodUs;
+
+        count++;
+        if (periodUs < minPeriodUs) minPeriodUs = periodUs;
+        if (periodUs > maxPeriodUs) maxPeriodUs = periodUs;
+        sumPeriodUs += periodUs;
+        if (jitter > maxJitterUs) maxJitterUs = jitter;
+        sumSqJitterUs += (uint64_t)jitter * jitter;
+        if (execUs > maxExecUs) maxExecUs = execUs;
+        sumExecUs += execUs;
+        if (execUs > nominalUs) overruns++;
+    }
+
+    float meanPeriodUs() const { return count ? (float)sumPeriodUs / count : 0; }
+    float rmsJitterUs() const { return count ? sqrtf((float)sumSqJitterUs / count) : 0; }
+    float meanExecUs() const { return count ? (float)sumExecUs / count : 0; }
+};
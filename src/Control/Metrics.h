@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Durations of one code path in Clock::cycles() (CPU cycles on the board, TSC
+// ticks on x86 hosts, ns on other hosts), counted in power-of-two buckets so
+// record() is a handful of instructions and can sit inside the control loop.
+// Written by one task, read by diagnostics; readers may see a torn update.
+class CycleHistogram
+{
+public:
+    static constexpr int FIRST_BIT = 8;    // first bucket: < 256 cycles, ~1 us at 240 MHz
+    static constexpr int BUCKETS = 16;     // finite buckets, then one for the rest
+
+    CycleHistogram() : m_buckets(), m_sum(0), m_max(0) {}
+
+    void record(uint32_t cycles)
+    {
+        int bucket = (cycles ? 32 - __builtin_clz(cycles) : 0) - FIRST_BIT;
+        if (bucket < 0) bucket = 0;
+        if (bucket > BUCKETS) bucket = BUCKETS;
+        m_buckets[bucket]++;
+        m_sum += cycles;
+        if (cycles > m_max) m_max = cycles;
+    }
+
+    // Bucket i < BUCKETS holds durations below bound(i) cycles
+    static uint32_t bound(int i) { return 1u << (FIRST_BIT + i); }
+    uint32_t bucket(int i) const { return m_buckets[i]; }
+    uint64_t sum() const { return m_sum; }
+    uint32_t max() const { return m_max; }
+
+private:
+    uint32_t m_buckets[BUCKETS + 1];
+    uint64_t m_sum;
+    uint32_t m_max;
+};
+
+// Prometheus text exposition. Out is anything with printf(): an
+// AsyncResponseStream on the board, stdout on the host.
+
+template <typename Out>
+void writeMetricHeader(Out &out, const char *name, const char *type, const char *help)
+{
+    out.printf("# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+// One series of a histogram family in seconds; labels without braces, e.g.
+// stage="kf",joint="arm"
+template <typename Out>
+void writeHistogram(Out &out, const char *name, const char *labels, const CycleHistogram &histogram,
+                    uint64_t cyclesPerSecond)
+{
+    unsigned long count = 0;
+    for (int i = 0; i < CycleHistogram::BUCKETS; i++) {
+        count += histogram.bucket(i);
+        out.printf("%s_bucket{%s,le=\"%.3g\"} %lu\n", name, labels,
+                   (double)CycleHistogram::bound(i) / cyclesPerSecond, count);
+    }
+    count += histogram.bucket(CycleHistogram::BUCKETS);
+    out.printf("%s_bucket{%s,le=\"+Inf\"} %lu\n", name, labels, count);
+    out.printf("%s_sum{%s} %.9f\n", name, labels, (double)histogram.sum() / cyclesPerSecond);
+    out.printf("%s_count{%s} %lu\n", name, labels, count);
+}
+
+// Stage histograms share one family, robotarm_stage_seconds{stage, joint};
+// stages that are not per joint leave joint out
+template <typename Out>
+void writeStage(Out &out, const char *stage, const char *joint, const CycleHistogram &histogram,
+                uint64_t cyclesPerSecond)
+{
+    char labels[64];
+    if (joint) snprintf(labels, sizeof(labels), "stage=\"%s\",joint=\"%s\"", stage, joint);
+    else snprintf(labels, sizeof(labels), "stage=\"%s\"", stage);
+    writeHistogram(out, "robotarm_stage_seconds", labels, histogram, cyclesPerSecond);
+}
+
+template <typename Out>
+void writeStageHeader(Out &out)
+{
+    writeMetricHeader(out, "robotarm_stage_seconds", "histogram", "Time spent per control path stage");
+}
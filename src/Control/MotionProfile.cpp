@@ -0,0 +1,175 @@
+#include "MotionProfile.h"
+
+#include <math.h>
+
+MotionProfile::MotionProfile():
+    m_shape(SCURVE), m_maxVelocity(90), m_maxAcceleration(360), m_maxJerk(3600),
+    m_count(0), m_index(0), m_segmentStart(0), m_startUs(0),
+    m_endPos(0), m_endVel(0), m_target(0) {}
+
+void MotionProfile::setLimits(float maxVelocity, float maxAcceleration, float maxJerk) {
+    m_maxVelocity = maxVelocity;
+    m_maxAcceleration = maxAcceleration;
+    m_maxJerk = maxJerk;
+}
+
+void MotionProfile::reset(float pos) {
+    m_count = 0;
+    m_endPos = pos;
+    m_endVel = 0;
+    m_target = pos;
+}
+
+// Jerk-limited change from velocity v0 and acceleration a0 to v1 at zero
+// acceleration: ramp the acceleration to a peak (past a0 if need be), hold
+// it, ramp it out. TRAPEZOIDAL jumps the acceleration, so a0 plays no part.
+int MotionProfile::changePhases(float v0, float a0, float v1, Phase *phases) const {
+    if (m_shape == TRAPEZOIDAL) {
+        float dir = v1 > v0 ? 1.0f : -1.0f;
+        phases[0] = Phase{fabsf(v1 - v0) / m_maxAcceleration, dir * m_maxAcceleration, 0};
+        return 1;
+    }
+
+    // Work in the direction of the change: a is the acceleration along it
+    float dir = v1 >= restVelocity(v0, a0) ? 1.0f : -1.0f;
+    float a = a0 * dir;
+    float dv = (v1 - v0) * dir;
+    float limit = fmaxf(m_maxAcceleration, a);
+
+    // Ramps a -> peak -> 0 alone cover (2 peak^2 - a^2) / 2 jerk of velocity
+    float peak = sqrtf(fmaxf(dv * m_maxJerk + 0.5f * a * a, 0));
+    float hold = 0;
+    if (peak > limit) {
+        peak = limit;
+        hold = (dv - (peak * peak - 0.5f * a * a) / m_maxJerk) / peak;
+    }
+    phases[0] = Phase{(peak - a) / m_maxJerk, dir * a, dir * m_maxJerk};
+    phases[1] = Phase{hold, dir * peak, 0};
+    phases[2] = Phase{peak / m_maxJerk, dir * peak, -dir * m_maxJerk};
+    return 3;
+}
+
+// Velocity reached by ramping a0 straight out
+float MotionProfile::restVelocity(float v0, float a0) const {
+    if (m_shape == TRAPEZOIDAL) return v0;
+    return v0 + 0.5f * a0 * fabsf(a0) / m_maxJerk;
+}
+
+float MotionProfile::changeDistance(float v0, float a0, float v1) const {
+    Phase phases[CHANGE_PHASES];
+    int n = changePhases(v0, a0, v1, phases);
+    Segment s = {0, 0, v0, 0, 0};
+    for (int i = 0; i < n; i++) {
+        if (phases[i].duration <= 0) continue;
+        s.acc = phases[i].acc;
+        s.jerk = phases[i].jerk;
+        Point end = evaluate(s, phases[i].duration);
+        s.pos = end.pos;
+        s.vel = end.vel;
+    }
+    return s.pos;
+}
+
+// Highest cruise speed up to vmax for which (v0, a0) -> peak -> 0 fits in
+// distance; never below the speed ramping a0 out reaches
+float MotionProfile::peakVelocity(float v0, float a0, float distance) const {
+    float lo = restVelocity(v0, a0), hi = m_maxVelocity;
+    if (hi < lo) hi = lo;
+    if (changeDistance(v0, a0, hi) + changeDistance(hi, 0, 0) <= distance) return hi;
+    for (int i = 0; i < 24; i++) {
+        float mid = 0.5f * (lo + hi);
+        if (changeDistance(v0, a0, mid) + changeDistance(mid, 0, 0) <= distance) lo = mid;
+        else hi = mid;
+    }
+    return lo;
+}
+
+MotionProfile::Point MotionProfile::evaluate(const Segment &s, float t) const {
+    Point p;
+    p.acc = s.acc + s.jerk * t;
+    p.vel = s.vel + (s.acc + 0.5f * s.jerk * t) * t;
+    p.pos = s.pos + (s.vel + (0.5f * s.acc + s.jerk * t * (1.0f / 6)) * t) * t;
+    return p;
+}
+
+void MotionProfile::append(float duration, float acc, float jerk) {
+    if (duration <= 0 || m_count >= MAX_SEGMENTS) return;
+    Segment &s = m_segments[m_count++];
+    s.duration = duration;
+    s.pos = m_endPos;
+    s.vel = m_endVel;
+    s.acc = acc;
+    s.jerk = jerk;
+
+    Point end = evaluate(s, duration);
+    m_endPos = end.pos;
+    m_endVel = end.vel;
+}
+
+void MotionProfile::appendChange(float v0, float a0, float v1) {
+    if (v1 == v0 && a0 == 0) return;
+    Phase phases[CHANGE_PHASES];
+    int n = changePhases(v0, a0, v1, phases);
+    for (int i = 0; i < n; i++) append(phases[i].duration, phases[i].acc, phases[i].jerk);
+    m_endVel = v1; // exact, whatever rounding the segments picked up
+}
+
+void MotionProfile::moveTo(float target, uint32_t nowUs) {
+    if (target == m_target && m_count > 0) return;
+    Point from = sample(nowUs);
+
+    m_count = 0;
+    m_index = 0;
+    m_segmentStart = 0;
+    m_startUs = nowUs;
+    m_endPos = from.pos;
+    m_endVel = from.vel;
+    m_target = target;
+
+    // Work in the direction of the move: positive distance, signed speeds
+    float dir = target >= from.pos ? 1.0f : -1.0f;
+    float v = from.vel * dir;
+    float a = from.acc * dir;
+    float distance = (target - from.pos) * dir;
+    float rest = restVelocity(v, a);
+
+    if (rest > 0 && changeDistance(v, a, rest) + changeDistance(rest, 0, 0) <= distance) {
+        float peak = peakVelocity(v, a, distance);
+        float cruise = distance - changeDistance(v, a, peak) - changeDistance(peak, 0, 0);
+        appendChange(v * dir, a * dir, peak * dir);
+        append(cruise / peak, 0, 0);
+        appendChange(peak * dir, 0, 0);
+    } else {
+        // Moving away or too fast to stop in time: stop first, then start over
+        appendChange(from.vel, from.acc, 0);
+        dir = target >= m_endPos ? 1.0f : -1.0f;
+        distance = (target - m_endPos) * dir;
+        float peak = peakVelocity(0, 0, distance);
+        if (peak > 0) {
+            float cruise = distance - changeDistance(0, 0, peak) - changeDistance(peak, 0, 0);
+            appendChange(0, 0, peak * dir);
+            append(cruise / peak, 0, 0);
+            appendChange(peak * dir, 0, 0);
+        }
+    }
+    if (m_count == 0) reset(target);
+}
+
+MotionProfile::Point MotionProfile::sample(uint32_t nowUs) {
+    if (m_count == 0) {
+        Point rest = {m_endPos, 0, 0};
+        return rest;
+    }
+
+    float t = (nowUs - m_startUs) * 1e-6f;
+    while (m_index < m_count && t >= m_segmentStart + m_segments[m_index].duration) {
+        m_segmentStart += m_segments[m_index].duration;
+        m_index++;
+    }
+    if (m_index == m_count) {
+        reset(m_target);
+        Point rest = {m_target, 0, 0};
+        return rest;
+    }
+    return evaluate(m_segments[m_index], t - m_segmentStart);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <stdint.h>
+
+// Point-to-point motion profile for one joint, sampled every control tick.
+//
+// A move is planned once in moveTo() as a list of constant-jerk segments
+// (constant-acceleration for TRAPEZOIDAL) and sample() just evaluates the
+// current segment. A new target during a move carries on from the current
+// position, velocity and acceleration (the S-curve ramps the acceleration
+// rather than dropping it): straight to the new target if it lies ahead
+// beyond the stopping distance, otherwise via a stop. Re-issuing the target
+// of the move in progress keeps its plan.
+class MotionProfile
+{
+public:
+    enum Shape { TRAPEZOIDAL, SCURVE };
+
+    struct Point
+    {
+        float pos; // deg
+        float vel; // deg/s
+        float acc; // deg/s^2
+    };
+
+    MotionProfile();
+
+    void setLimits(float maxVelocity, float maxAcceleration, float maxJerk);
+    void setShape(Shape shape) { m_shape = shape; }
+
+    // At rest at pos, no move in progress.
+    void reset(float pos);
+    // Plan a move from wherever the profile is at nowUs.
+    void moveTo(float target, uint32_t nowUs);
+
+    Point sample(uint32_t nowUs);
+
+    bool done() const { return m_count == 0; }
+    float target() const { return m_target; }
+
+private:
+    struct Segment
+    {
+        float duration;
+        float pos;
+        float vel;
+        float acc;
+        float jerk;
+    };
+
+    // One constant-jerk piece of a velocity change
+    struct Phase
+    {
+        float duration;
+        float acc;
+        float jerk;
+    };
+
+    static const int MAX_SEGMENTS = 10; // stop (3) + accelerate (3) + cruise + decelerate (3)
+    static const int CHANGE_PHASES = 3;
+
+    int changePhases(float v0, float a0, float v1, Phase *phases) const;
+    float restVelocity(float v0, float a0) const;
+    float changeDistance(float v0, float a0, float v1) const;
+    float peakVelocity(float v0, float a0, float distance) const;
+    void append(float duration, float acc, float jerk);
+    void appendChange(float v0, float a0, float v1);
+    Point evaluate(const Segment &s, float t) const;
+
+    Shape m_shape;
+    float m_maxVelocity;
+    float m_maxAcceleration;
+    float m_maxJerk;
+
+    Segment m_segments[MAX_SEGMENTS];
+    int m_count;
+    int m_index;
+    float m_segmentStart; // s since m_startUs
+    uint32_t m_startUs;
+
+    float m_endPos; // state at the end of the planned segments
+    float m_endVel;
+    float m_target;
+};
@@ -0,0 +1,45 @@
+#include "MotorDriver.h"
+
+#include <math.h>
+
+MotorDriver::MotorDriver():
+    m_motor(nullptr), m_shaping(), m_requested(), m_applied(0),
+    m_state(Motor::COAST), m_direction(Motor::COAST) {}
+
+void MotorDriver::begin() {
+    m_motor->begin();
+    m_state = Motor::COAST;
+    m_direction = Motor::COAST;
+}
+
+void MotorDriver::setShaping(const DriveShaping &shaping) {
+    m_requested.write(shaping);
+}
+
+float MotorDriver::write(float duty) {
+    // The control task may have preempted the writer: never spin, a torn
+    // read is retried at the next write()
+    uint32_t version = m_requested.version();
+    if (version != m_applied) {
+        DriveShaping shaping;
+        if (m_requested.tryRead(shaping)) {
+            m_shaping = shaping;
+            m_applied = version;
+        }
+    }
+
+    const float magnitude = fabsf(duty);
+    const Motor::Drive wanted = duty > 0 ? Motor::FORWARD : Motor::REVERSE;
+    const bool reversing = m_direction != Motor::COAST && wanted != m_direction;
+    if (magnitude <= m_shaping.deadband || (reversing && magnitude <= m_shaping.hysteresis)) {
+        m_state = m_shaping.brake ? Motor::BRAKE : Motor::COAST;
+        m_motor->drive(m_state, m_shaping.brake ? 1.0f : 0.0f);
+        return 0;
+    }
+
+    float level = m_shaping.offset + magnitude * (MAX_DUTY - m_shaping.offset) / MAX_DUTY;
+    if (level > MAX_DUTY) level = MAX_DUTY;
+    m_state = m_direction = wanted;
+    m_motor->drive(wanted, level / MAX_DUTY);
+    return wanted == Motor::FORWARD ? level : -level;
+}
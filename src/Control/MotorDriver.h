@@ -0,0 +1,48 @@
+#pragma once
+
+#include "HAL/HAL.h"
+#include "SeqLock.h"
+
+// How a signed duty becomes an H-bridge state, per joint. All in duty units
+// (MotorDriver::MAX_DUTY = full scale), like the PID outputs.
+struct DriveShaping
+{
+    float deadband = 0;     // |duty| at or below this idles the bridge
+    float offset = 0;       // added to every non-zero output, to break stiction
+    float hysteresis = 0;   // a reversal needs |duty| above this, else idle
+    bool brake = false;     // idle shorts the motor; otherwise it coasts
+};
+
+// Turns the controller's signed duty into a Motor::drive() call: deadband,
+// stiction offset (the rest of the range is scaled so full scale stays full
+// scale), sign hysteresis against chatter around zero, and brake or coast
+// when idle. Fractional duties are kept; the bridge has the resolution.
+class MotorDriver
+{
+public:
+    static constexpr float MAX_DUTY = 255.0f;
+
+    MotorDriver();
+
+    void attach(Motor *motor) { m_motor = motor; }
+    void begin();
+
+    // Published through a SeqLock and picked up by a later write(), so one
+    // other task (the web handlers) may call it while the control task runs.
+    // Only one task may set shaping.
+    void setShaping(const DriveShaping &shaping);
+    DriveShaping shaping() const { return m_requested.read(); }
+
+    // Returns the signed duty applied, 0 when idle
+    float write(float duty);
+
+    Motor::Drive state() const { return m_state; }
+
+private:
+    Motor *m_motor;
+    DriveShaping m_shaping;             // in use, control task only
+    SeqLock<DriveShaping> m_requested;
+    uint32_t m_applied;                 // m_requested version in m_shaping
+    Motor::Drive m_state;
+    Motor::Drive m_direction;   // last direction driven, kept while idle
+};
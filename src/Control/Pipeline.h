@@ -0,0 +1,191 @@
+#pragma once
+
+#include <stddef.h>
+#include <cmath>
+#include <tuple>
+#include <utility>
+
+#include <kf.h>
+
+// Per-joint measurement pipeline: a fixed list of stages chosen at compile
+// time, each `Scalar process(Scalar x, Scalar dt)`. Stages are held by value
+// and called directly, so a pipeline compiles down to the inlined arithmetic
+// of its stages. dt is in seconds.
+template <typename... Stages>
+class Pipeline
+{
+public:
+    using Scalar = typename std::tuple_element<0, std::tuple<Stages...>>::type::Scalar;
+
+    explicit Pipeline(const Stages &... stages) : m_stages(stages...) {}
+
+    Scalar process(Scalar x, Scalar dt)
+    {
+        return run(x, dt, std::index_sequence_for<Stages...>());
+    }
+
+    template <typename Stage>
+    Stage &get()
+    {
+        return std::get<Stage>(m_stages);
+    }
+
+    template <typename Stage>
+    const Stage &get() const
+    {
+        return std::get<Stage>(m_stages);
+    }
+
+private:
+    template <size_t... I>
+    Scalar run(Scalar x, Scalar dt, std::index_sequence<I...>)
+    {
+        ((x = std::get<I>(m_stages).process(x, dt)), ...);
+        return x;
+    }
+
+    std::tuple<Stages...> m_stages;
+};
+
+// AS5600 counts (12 bits per turn) to degrees.
+template <typename T = float>
+struct CountsToDegrees
+{
+    using Scalar = T;
+
+    Scalar process(Scalar counts, Scalar) const { return counts * Scalar(360.0 / 4096.0); }
+};
+
+template <typename T = float>
+struct Offset
+{
+    using Scalar = T;
+
+    Scalar offset;
+
+    explicit Offset(Scalar offset) : offset(offset) {}
+    Scalar process(Scalar x, Scalar) const { return x + offset; }
+};
+
+// Sensor shaft to joint angle through a reduction.
+template <typename T = float>
+struct GearRatio
+{
+    using Scalar = T;
+
+    Scalar inverse;
+
+    explicit GearRatio(Scalar ratio) : inverse(Scalar(1) / ratio) {}
+    Scalar process(Scalar x, Scalar) const { return x * inverse; }
+};
+
+// Wrapped angle (period 360 deg by default) to a continuous one. Period 0
+// passes the input through, for sources that are continuous already.
+template <typename T = float>
+struct Unwrap
+{
+    using Scalar = T;
+
+    Scalar period;
+    Scalar turns;
+    Scalar last;
+    bool primed;
+
+    explicit Unwrap(Scalar period = 360) : period(period), turns(0), last(0), primed(false) {}
+
+    Scalar process(Scalar x, Scalar)
+    {
+        if (primed && period > Scalar(0)) {
+            const Scalar step = x - last;
+            if (step > period / 2) turns -= period;
+            else if (step < -period / 2) turns += period;
+        }
+        last = x;
+        primed = true;
+        return x + turns;
+    }
+};
+
+// Median of the last N samples (N odd, small).
+template <typename T = float, int N = 3>
+struct Median
+{
+    using Scalar = T;
+    static_assert(N % 2 == 1, "Median needs an odd window");
+
+    Scalar window[N];
+    int next;
+    int filled;
+
+    Median() : window(), next(0), filled(0) {}
+
+    Scalar process(Scalar x, Scalar)
+    {
+        window[next] = x;
+        next = (next + 1) % N;
+        if (filled < N) filled++;
+
+        Scalar sorted[N];
+        for (int i = 0; i < filled; i++) {
+            Scalar v = window[i];
+            int j = i;
+            for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+            sorted[j] = v;
+        }
+        return sorted[filled / 2];
+    }
+};
+
+// Holds the previous output when a sample jumps by more than maxStep, but
+// gives in after maxRejects consecutive rejections (the jump was real).
+template <typename T = float>
+struct OutlierReject
+{
+    using Scalar = T;
+
+    Scalar maxStep;
+    int maxRejects;
+    int rejected;
+    Scalar last;
+    bool primed;
+
+    OutlierReject(Scalar maxStep, int maxRejects) :
+        maxStep(maxStep), maxRejects(maxRejects), rejected(0), last(0), primed(false) {}
+
+    Scalar process(Scalar x, Scalar)
+    {
+        if (primed && std::abs(x - last) > maxStep && rejected < maxRejects) {
+            rejected++;
+            return last;
+        }
+        rejected = 0;
+        last = x;
+        primed = true;
+        return x;
+    }
+};
+
+// Constant-velocity Kalman filter on the angle; velocity() is the estimate.
+template <typename T = float>
+struct Kalman
+{
+    using Scalar = T;
+
+    KF<Scalar> filter;
+    Scalar measVariance;
+
+    Kalman(Scalar accelVariance, Scalar measVariance, bool steadyState = true) :
+        filter(0, 0, accelVariance), measVariance(measVariance)
+    {
+        filter.setSteadyState(steadyState);
+    }
+
+    Scalar process(Scalar x, Scalar dt)
+    {
+        filter.predict(dt);
+        filter.update(x, measVariance);
+        return filter.pos();
+    }
+
+    Scalar velocity() const { return filter.vel(); }
+};
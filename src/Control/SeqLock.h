@@ -0,0 +1,55 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Single-writer sequence lock. The writer never blocks; readers retry while a
+// write is in progress. Readers must not preempt the writer on its own core
+// (give the writer the higher priority), or read() spins until it resumes.
+template <typename T>
+class SeqLock
+{
+public:
+    SeqLock() : m_seq(0), m_value() {}
+
+    void write(const T &value)
+    {
+        uint32_t seq = m_seq.load(std::memory_order_relaxed);
+        m_seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        m_value = value;
+        m_seq.store(seq + 2, std::memory_order_release);
+    }
+
+    T read() const
+    {
+        T value;
+        uint32_t before, after;
+        do {
+            before = m_seq.load(std::memory_order_acquire);
+            value = m_value;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            after = m_seq.load(std::memory_order_relaxed);
+        } while ((before & 1) || before != after);
+        return value;
+    }
+
+    // One attempt, for readers that must not spin (e.g. a higher priority
+    // task that could have preempted the writer): false if a write was in
+    // progress, value is then unspecified.
+    bool tryRead(T &value) const
+    {
+        uint32_t before = m_seq.load(std::memory_order_acquire);
+        value = m_value;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = m_seq.load(std::memory_order_relaxed);
+        return !(before & 1) && before == after;
+    }
+
+    // Number of completed writes.
+    uint32_t version() const { return m_seq.load(std::memory_order_acquire) / 2; }
+
+private:
+    std::atomic<uint32_t> m_seq;
+    T m_value;
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+#include <atomic>
+
+// Lock-free single-producer/single-consumer ring of N (a power of two)
+// preallocated items. Indices run freely and wrap at 2^32.
+template <typename T, uint32_t N>
+class SpscRing
+{
+    static_assert(N && (N & (N - 1)) == 0, "SpscRing size must be a power of two");
+
+public:
+    SpscRing() : m_head(0), m_tail(0) {}
+
+    // Producer side
+    bool push(const T &item)
+    {
+        uint32_t head = m_head.load(std::memory_order_relaxed);
+        if (head - m_tail.load(std::memory_order_acquire) == N) return false;
+        m_items[head & (N - 1)] = item;
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    uint32_t writeIndex() const { return m_head.load(std::memory_order_relaxed); }
+
+    // Consumer side
+    bool pop(T &item)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) return false;
+        item = m_items[tail & (N - 1)];
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    const T *peek() const
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail == m_head.load(std::memory_order_acquire)) return nullptr;
+        return &m_items[tail & (N - 1)];
+    }
+
+    // Drop everything written before index (a writeIndex() value).
+    void discardUpTo(uint32_t index)
+    {
+        uint32_t tail = m_tail.load(std::memory_order_relaxed);
+        uint32_t head = m_head.load(std::memory_order_acquire);
+        if (index - tail <= head - tail) m_tail.store(index, std::memory_order_release);
+    }
+
+    void discardAll() { m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release); }
+
+    // Either side; may be stale by the time it is used
+    uint32_t size() const { return m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire); }
+    static constexpr uint32_t capacity() { return N; }
+
+private:
+    T m_items[N];
+    std::atomic<uint32_t> m_head;
+    std::atomic<uint32_t> m_tail;
+};
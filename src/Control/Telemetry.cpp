@@ -0,0 +1,47 @@
+#include "Telemetry.h"
+
+#include <string.h>
+
+Telemetry::Telemetry():
+    m_decimation(0), m_count(0), m_dropped(0) {}
+
+void Telemetry::record(const TickRecord &tick) {
+    if (m_decimation == 0) return;
+    if (++m_count < m_decimation) return;
+    m_count = 0;
+    if (!m_queue.push(tick)) m_dropped = m_dropped + 1;
+}
+
+static uint8_t *put(uint8_t *p, const void *value, size_t len) {
+    memcpy(p, value, len); // both targets are little-endian
+    return p + len;
+}
+
+size_t Telemetry::packFrame(uint8_t *buf, size_t cap) {
+    if (cap < HEADER_SIZE + RECORD_SIZE || m_queue.peek() == nullptr) return 0;
+
+    uint8_t *p = buf + HEADER_SIZE;
+    uint16_t count = 0;
+    TickRecord tick;
+    while ((size_t)(p - buf) + RECORD_SIZE <= cap && m_queue.pop(tick)) {
+        p = put(p, &tick.timeUs, 4);
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            const JointTick &jt = tick.joint[j];
+            p = put(p, &jt.angle, 4);
+            p = put(p, &jt.setpoint, 4);
+            p = put(p, &jt.velocity, 4);
+            p = put(p, &jt.p, 4);
+            p = put(p, &jt.i, 4);
+            p = put(p, &jt.d, 4);
+            p = put(p, &jt.duty, 2);
+        }
+        count++;
+    }
+
+    uint32_t dropped = m_dropped;
+    buf[0] = VERSION;
+    buf[1] = JOINT_COUNT;
+    put(buf + 2, &count, 2);
+    put(buf + 4, &dropped, 4);
+    return p - buf;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "ControlLoop.h"
+#include "SpscRing.h"
+
+// Decimated per-tick records for live plotting. The control task calls
+// record() every step; a sender drains the queue in batches with
+// packFrame(), so the control path never waits on the network.
+//
+// Frame, little-endian:
+//   header  u8 version (1), u8 joints (2), u16 count, u32 dropped
+//   record  u32 timeUs, per joint: f32 angle, setpoint, velocity, p, i, d, i16 duty
+class Telemetry
+{
+public:
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 8;
+    static const size_t JOINT_SIZE = 6 * 4 + 2;
+    static const size_t RECORD_SIZE = 4 + JOINT_COUNT * JOINT_SIZE;
+    static const uint32_t QUEUE = 256;
+
+    Telemetry();
+
+    // Keep every decimation-th step; 0 turns telemetry off.
+    void setDecimation(uint32_t decimation) { m_decimation = decimation; }
+    uint32_t decimation() const { return m_decimation; }
+
+    void record(const TickRecord &tick);
+
+    // Pack up to as many queued records as fit in buf; 0 if none are queued.
+    size_t packFrame(uint8_t *buf, size_t cap);
+
+private:
+    SpscRing<TickRecord, QUEUE> m_queue;
+    volatile uint32_t m_decimation;
+    uint32_t m_count;
+    volatile uint32_t m_dropped;
+};
@@ -0,0 +1,44 @@
+#include "Teleop.h"
+
+#include <math.h>
+#include <string.h>
+
+TeleopReceiver::TeleopReceiver():
+    m_started(false), m_lastSeq(0), m_accepted(0), m_stale(0), m_malformed(0) {}
+
+TeleopReceiver::Status TeleopReceiver::receive(const uint8_t *data, size_t len, float angles[JOINT_COUNT]) {
+    if (len != PACKET_SIZE || data[0] != VERSION || data[1] != JOINT_COUNT) {
+        m_malformed++;
+        return MALFORMED;
+    }
+
+    uint32_t seq;
+    float next[JOINT_COUNT];
+    memcpy(&seq, data + 4, 4); // both targets are little-endian
+    memcpy(next, data + HEADER_SIZE, sizeof(next));
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        if (!isfinite(next[j])) {
+            m_malformed++;
+            return MALFORMED;
+        }
+    }
+
+    // Wrap-safe: anything not ahead of the last accepted seq is stale
+    if (m_started && (int32_t)(seq - m_lastSeq) <= 0) {
+        m_stale++;
+        return STALE;
+    }
+    m_started = true;
+    m_lastSeq = seq;
+    m_accepted++;
+    memcpy(angles, next, sizeof(next));
+    return ACCEPTED;
+}
+
+size_t TeleopReceiver::encodeAck(uint8_t *buf, const uint8_t *data, size_t len, Status status) const {
+    memset(buf, 0, ACK_SIZE);
+    buf[0] = VERSION;
+    buf[1] = status;
+    if (len >= HEADER_SIZE) memcpy(buf + 4, data + 4, 8);
+    return ACK_SIZE;
+}
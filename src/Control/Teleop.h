@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "Joints.h"
+
+// Filter for streamed teleop setpoints (UDP, 100-200 Hz). Only packets newer
+// than the last accepted one get through; late, duplicated or reordered ones
+// are dropped, so a burst of old packets can never drag the arm backwards.
+// Deadman handling is left to the caller, which calls restart() once the
+// stream has timed out so a restarted sender is accepted from any seq.
+//
+// Packet, little-endian:
+//   u8 version (1), u8 joints (2), u16 reserved, u32 seq, u32 sentUs, f32 angle[joints] (deg)
+// Each packet is answered with an ack echoing seq and sentUs for round-trip timing:
+//   u8 version (1), u8 status, u16 reserved, u32 seq, u32 sentUs
+class TeleopReceiver
+{
+public:
+    static const uint8_t VERSION = 1;
+    static const size_t HEADER_SIZE = 12;
+    static const size_t PACKET_SIZE = HEADER_SIZE + 4 * JOINT_COUNT;
+    static const size_t ACK_SIZE = 12;
+
+    enum Status : uint8_t { ACCEPTED, STALE, MALFORMED };
+
+    TeleopReceiver();
+
+    // On ACCEPTED, angles holds the new setpoint of every joint
+    Status receive(const uint8_t *data, size_t len, float angles[JOINT_COUNT]);
+    size_t encodeAck(uint8_t *buf, const uint8_t *data, size_t len, Status status) const;
+
+    void restart() { m_started = false; }
+
+    uint32_t accepted() const { return m_accepted; }
+    uint32_t stale() const { return m_stale; }
+    uint32_t malformed() const { return m_malformed; }
+
+private:
+    volatile bool m_started;
+    uint32_t m_lastSeq;
+    uint32_t m_accepted;
+    uint32_t m_stale;
+    uint32_t m_malformed;
+};
@@ -0,0 +1,140 @@
+#include "Trajectory.h"
+#include "Angle.h"
+
+TrajectoryPlayer::TrajectoryPlayer():
+    m_replace(false), m_replaceUpTo(0), m_playing(false), m_originUs(0),
+    m_prev(), m_next(), m_starved(false), m_starvedSinceUs(0), m_underruns(0) {}
+
+void TrajectoryPlayer::replace() {
+    m_replaceUpTo.store(m_ring.writeIndex(), std::memory_order_relaxed);
+    m_replace.store(true, std::memory_order_release);
+}
+
+void TrajectoryPlayer::stop() {
+    m_ring.discardAll();
+    m_playing = false;
+}
+
+bool TrajectoryPlayer::sample(uint32_t nowUs, MotionProfile::Point refs[JOINT_COUNT]) {
+    if (m_replace.load(std::memory_order_acquire)) {
+        m_ring.discardUpTo(m_replaceUpTo.load(std::memory_order_relaxed));
+        m_replace.store(false, std::memory_order_relaxed);
+        m_playing = false;
+    }
+
+    if (!m_playing) {
+        if (!m_ring.pop(m_next)) return false;
+        m_playing = true;
+        m_starved = false;
+        m_originUs = nowUs;
+        m_prev.timeUs = 0;
+        for (int j = 0; j < JOINT_COUNT; j++) m_prev.angle[j] = refs[j].pos;
+        unwrapNext();
+    }
+
+    uint32_t t = nowUs - m_originUs;
+    while (t >= m_next.timeUs && m_ring.peek() != nullptr) {
+        m_prev = m_next;
+        m_ring.pop(m_next);
+        unwrapNext();
+        if (m_starved) {
+            m_starved = false;
+            m_underruns++;
+        }
+    }
+
+    if (t >= m_next.timeUs || m_next.timeUs == m_prev.timeUs) {
+        // Past the last queued point: hold it, and give up after a while
+        if (!m_starved) {
+            m_starved = true;
+            m_starvedSinceUs = nowUs;
+        } else if (nowUs - m_starvedSinceUs > END_HOLD_US) {
+            m_playing = false;
+            m_starved = false;
+        }
+        for (int j = 0; j < JOINT_COUNT; j++) {
+            refs[j].pos = m_next.angle[j];
+            refs[j].vel = 0;
+            refs[j].acc = 0;
+        }
+        return true;
+    }
+
+    float span = (float)(m_next.timeUs - m_prev.timeUs);
+    float f = (t - m_prev.timeUs) / span;
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        float delta = m_next.angle[j] - m_prev.angle[j];
+        refs[j].pos = m_prev.angle[j] + delta * f;
+        refs[j].vel = delta / span * 1e6f;
+        refs[j].acc = 0;
+    }
+    return true;
+}
+
+// Waypoints are in -180..180; on joints that turn freely, continue from the
+// previous point the short way round
+void TrajectoryPlayer::unwrapNext() {
+    for (int j = 0; j < JOINT_COUNT; j++)
+        m_next.angle[j] = nearestTarget(j, m_next.angle[j], m_prev.angle[j]);
+}
+
+WaypointDecoder::WaypointDecoder(TrajectoryPlayer &player):
+    m_player(player) {
+    begin();
+}
+
+void WaypointDecoder::begin() {
+    m_fill = 0;
+    m_haveHeader = false;
+    m_error = false;
+    m_expected = 0;
+    m_accepted = 0;
+    m_dropped = 0;
+    m_refused = 0;
+}
+
+static uint16_t readU16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t readU32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void WaypointDecoder::feed(const uint8_t *data, size_t len) {
+    for (size_t i = 0; i < len && !m_error; i++) {
+        m_buf[m_fill++] = data[i];
+
+        if (!m_haveHeader) {
+            if (m_fill < HEADER_SIZE) continue;
+            if (m_buf[0] != VERSION || m_buf[1] != JOINT_COUNT) {
+                m_error = true;
+                break;
+            }
+            m_expected = readU16(m_buf + 4);
+            if (m_buf[2] & FLAG_REPLACE) m_player.replace();
+            m_haveHeader = true;
+            m_fill = 0;
+        } else if (m_fill == POINT_SIZE) {
+            if (m_accepted + m_dropped + m_refused >= m_expected) {
+                m_error = true;
+                break;
+            }
+            Waypoint point;
+            point.timeUs = readU32(m_buf);
+            bool inRange = true;
+            for (int j = 0; j < JOINT_COUNT; j++) {
+                point.angle[j] = (int16_t)readU16(m_buf + 4 + 2 * j) * 0.01f;
+                if (point.angle[j] < JOINTS[j].minAngle || point.angle[j] > JOINTS[j].maxAngle) inRange = false;
+            }
+            if (!inRange) m_refused++;
+            else if (m_player.push(point)) m_accepted++;
+            else m_dropped++;
+            m_fill = 0;
+        }
+    }
+}
+
+bool WaypointDecoder::finish() {
+    return !m_error && m_haveHeader && m_fill == 0 && m_accepted + m_dropped + m_refused == m_expected;
+}
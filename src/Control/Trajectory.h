@@ -0,0 +1,103 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#include "SpscRing.h"
+#include "MotionProfile.h"
+#include "Joints.h"
+
+struct Waypoint
+{
+    uint32_t timeUs; // since the start of the trajectory
+    float angle[JOINT_COUNT];
+};
+
+// Timed multi-joint waypoints streamed into a preallocated ring by one
+// producer (the upload handler) and played back by the control task, which
+// interpolates linearly between neighbouring points. Playback time starts at
+// the first step that sees a point; the segment to the first point starts at
+// the joints' current setpoints. If the ring runs dry the last point is held
+// (an underrun if more points follow); points whose time has already passed
+// are skipped. Timestamps count from the start of the trajectory, and a
+// trajectory ends once its last point has been held for END_HOLD_US with
+// nothing new queued.
+class TrajectoryPlayer
+{
+public:
+    static const uint32_t CAPACITY = 1024;
+    static const uint32_t END_HOLD_US = 1000000;
+
+    TrajectoryPlayer();
+
+    // Producer side
+    bool push(const Waypoint &point) { return m_ring.push(point); }
+    // Drop what is queued so far; points pushed afterwards start a new trajectory.
+    void replace();
+
+    // Consumer side: while a trajectory is playing, overwrite refs with its
+    // position and velocity and return true.
+    bool sample(uint32_t nowUs, MotionProfile::Point refs[JOINT_COUNT]);
+    void stop();
+
+    bool playing() const { return m_playing; }
+    uint32_t queued() const { return m_ring.size(); }
+    uint32_t underruns() const { return m_underruns; }
+
+private:
+    void unwrapNext();
+
+    SpscRing<Waypoint, CAPACITY> m_ring;
+    std::atomic<bool> m_replace;
+    std::atomic<uint32_t> m_replaceUpTo;
+
+    bool m_playing;
+    uint32_t m_originUs;
+    Waypoint m_prev;
+    Waypoint m_next;
+    bool m_starved;
+    uint32_t m_starvedSinceUs;
+    uint32_t m_underruns;
+};
+
+// Incremental decoder for the upload body, so chunks can be pushed as they
+// arrive without buffering the request. Little-endian:
+//
+//   header  u8 version (1), u8 joints (2), u8 flags, u8 reserved, u16 count
+//   point   u32 timeUs, joints x i16 angle in centidegrees
+//
+// flags bit 0 (REPLACE) drops the queued trajectory first, otherwise the
+// points are appended. A point with any angle outside its joint's
+// minAngle..maxAngle is refused, like any other setpoint out of range.
+class WaypointDecoder
+{
+public:
+    static const uint8_t VERSION = 1;
+    static const uint8_t FLAG_REPLACE = 0x01;
+    static const size_t HEADER_SIZE = 6;
+    static const size_t POINT_SIZE = 4 + 2 * JOINT_COUNT;
+
+    explicit WaypointDecoder(TrajectoryPlayer &player);
+
+    void begin();
+    void feed(const uint8_t *data, size_t len);
+    // True if the body was well formed and complete.
+    bool finish();
+
+    uint16_t accepted() const { return m_accepted; }
+    uint16_t dropped() const { return m_dropped; }
+    uint16_t refused() const { return m_refused; }
+
+private:
+    TrajectoryPlayer &m_player;
+
+    uint8_t m_buf[HEADER_SIZE > POINT_SIZE ? HEADER_SIZE : POINT_SIZE];
+    size_t m_fill;
+    bool m_haveHeader;
+    bool m_error;
+    uint16_t m_expected;
+    uint16_t m_accepted;
+    uint16_t m_dropped;
+    uint16_t m_refused;
+};
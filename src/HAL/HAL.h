@@ -0,0 +1,50 @@
+#pragma once
+
+#include <stdint.h>
+
+// Hardware seen by the control path. The firmware binds these to the AS5600
+// sensors, LEDC/GPIO H-bridges and the Arduino clock (esp32/ESP32HAL.h); the
+// native build binds them to simulated devices (native/SimHAL.h).
+
+class Encoder
+{
+public:
+    virtual ~Encoder() {}
+
+    // Start a read in the background; the next readAngle()/readCumulative()
+    // collects it. No-op for encoders that can only read synchronously.
+    virtual void prefetch() {}
+
+    // Both return false if the sensor could not be read (bus busy or no magnet).
+    virtual bool readAngle(uint16_t &raw) = 0;           // 0..4095
+    virtual bool readCumulative(int32_t &counts) = 0;    // counts including full turns
+};
+
+class Motor
+{
+public:
+    // COAST leaves the motor free, BRAKE shorts it (level sets how hard)
+    enum Drive { COAST, FORWARD, REVERSE, BRAKE };
+
+    virtual ~Motor() {}
+
+    virtual void begin() = 0;
+    // Bridge state and PWM level, 0..1 of full on. Shaping from a signed
+    // duty is Control/MotorDriver's job.
+    virtual void drive(Drive state, float level) = 0;
+};
+
+class Clock
+{
+public:
+    virtual ~Clock() {}
+
+    virtual unsigned long micros() = 0;
+    virtual unsigned long millis() = 0;
+
+    // Free-running counter for timing code paths: CPU cycles on the board,
+    // TSC ticks on x86 hosts, nanoseconds on other hosts. It wraps, so only
+    // differences mean anything. The rate is 64-bit: host TSCs run past 4 GHz.
+    virtual uint32_t cycles() = 0;
+    virtual uint64_t cyclesPerSecond() = 0;
+};
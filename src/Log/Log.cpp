@@ -0,0 +1,120 @@
+#include "Log.h"
+
+#include <stdio.h>
+#include <string.h>
+
+Logger logger;
+
+static const char LEVEL_NAMES[] = "-EWID";
+static const size_t LINE_LENGTH = 160;
+
+Logger::Logger():
+    m_clock(nullptr), m_head(0), m_tail(0), m_dropped(0), m_reportedDrops(0)
+{
+    for (uint32_t n = 0; n < CAPACITY; n++) m_slots[n].seq.store(n, std::memory_order_relaxed);
+}
+
+// Bounded multi-producer queue: each slot's sequence number says whether it
+// is free for the producer at that position or filled for the consumer.
+void Logger::push(const LogRecord &record) {
+    uint32_t pos = m_head.load(std::memory_order_relaxed);
+    Slot *slot;
+    for (;;) {
+        slot = &m_slots[pos % CAPACITY];
+        int32_t diff = (int32_t)(slot->seq.load(std::memory_order_acquire) - pos);
+        if (diff == 0) {
+            if (m_head.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = m_head.load(std::memory_order_relaxed);
+        }
+    }
+    slot->record = record;
+    slot->seq.store(pos + 1, std::memory_order_release);
+}
+
+// printf with the saved arguments: each conversion is formatted on its own,
+// with the length modifier replaced to match how the argument was stored.
+size_t Logger::format(char *buf, size_t len, const LogRecord &record) {
+    size_t n = 0;
+    int arg = 0;
+    const char *f = record.format;
+    while (*f && n + 1 < len) {
+        if (*f != '%') {
+            buf[n++] = *f++;
+            continue;
+        }
+        if (f[1] == '%') {
+            buf[n++] = '%';
+            f += 2;
+            continue;
+        }
+
+        char spec[16];
+        size_t s = 0;
+        spec[s++] = *f++;
+        while (*f && strchr("-+ #0123456789.", *f) && s < sizeof(spec) - 4) spec[s++] = *f++;
+        while (*f && strchr("hlLzjt", *f)) f++;
+        char conv = *f ? *f++ : 's';
+
+        if (arg >= record.nargs) break;
+        const LogArg &a = record.args[arg++];
+        int w;
+        if (strchr("diouxXc", conv)) {
+            if (conv != 'c') {
+                spec[s++] = 'l';
+                spec[s++] = 'l';
+            }
+            spec[s++] = conv;
+            spec[s] = 0;
+            long long v = a.type == LogArg::FLOAT ? (long long)a.f : a.i;
+            w = conv == 'c' ? snprintf(buf + n, len - n, spec, (int)v) : snprintf(buf + n, len - n, spec, v);
+        } else if (strchr("feEgGaA", conv)) {
+            spec[s++] = conv;
+            spec[s] = 0;
+            double v = a.type == LogArg::FLOAT ? a.f : a.type == LogArg::INT ? (double)a.i : (double)a.u;
+            w = snprintf(buf + n, len - n, spec, v);
+        } else {
+            spec[s++] = conv == 'p' ? 'p' : 's';
+            spec[s] = 0;
+            const void *p = a.type == LogArg::PTR ? a.p : nullptr;
+            if (conv != 'p' && p == nullptr) p = "(null)";
+            w = snprintf(buf + n, len - n, spec, p);
+        }
+        if (w < 0) break;
+        n += (size_t)w < len - n ? (size_t)w : len - n - 1;
+    }
+    buf[n] = 0;
+    return n;
+}
+
+size_t Logger::drain(void (*write)(const char *line, size_t len), size_t max) {
+    char line[LINE_LENGTH];
+
+    uint32_t dropped = m_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_reportedDrops) {
+        int n = snprintf(line, sizeof(line), "(%lu log records dropped)\n",
+                         (unsigned long)(dropped - m_reportedDrops));
+        write(line, n);
+        m_reportedDrops = dropped;
+    }
+
+    size_t count = 0;
+    while (count < max) {
+        Slot &slot = m_slots[m_tail % CAPACITY];
+        if ((int32_t)(slot.seq.load(std::memory_order_acquire) - (m_tail + 1)) < 0) break;
+        LogRecord record = slot.record;
+        slot.seq.store(m_tail + CAPACITY, std::memory_order_release);
+        m_tail++;
+
+        int n = snprintf(line, sizeof(line), "%lu.%03lu %c ", (unsigned long)(record.timeUs / 1000000),
+                         (unsigned long)(record.timeUs / 1000 % 1000), LEVEL_NAMES[record.level]);
+        n += format(line + n, sizeof(line) - n - 1, record);
+        if (n == 0 || line[n - 1] != '\n') line[n++] = '\n';
+        write(line, n);
+        count++;
+    }
+    return count;
+}
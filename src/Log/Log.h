@@ -0,0 +1,148 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
+
+#include "HAL/HAL.h"
+
+// Deferred, level-gated logging. LOG_* calls below LOG_LEVEL compile to
+// nothing (arguments are not evaluated). The rest store the format pointer
+// and up to MAX_ARGS raw arguments in a lock-free ring; formatting and
+// output happen later in drain(), called from a low-priority task, so a
+// logging caller never waits on the UART. When the ring is full records
+// are dropped and counted.
+//
+// The format and any %s arguments are kept by pointer until drained: use
+// string literals or other strings that live for the whole program.
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARN 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) logger.log(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_WARN
+#define LOG_WARN(...) logger.log(LOG_LEVEL_WARN, __VA_ARGS__)
+#else
+#define LOG_WARN(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) logger.log(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) do {} while (0)
+#endif
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) logger.log(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) do {} while (0)
+#endif
+
+struct LogArg
+{
+    enum Type : uint8_t { INT, UINT, FLOAT, PTR };
+    Type type;
+    union
+    {
+        long long i;
+        unsigned long long u;
+        double f;
+        const void *p;
+    };
+};
+
+struct LogRecord
+{
+    static const int MAX_ARGS = 6;
+
+    uint32_t timeUs;
+    const char *format;
+    uint8_t level;
+    uint8_t nargs;
+    LogArg args[MAX_ARGS];
+};
+
+class Logger
+{
+public:
+    static const uint32_t CAPACITY = 64; // power of two
+
+    Logger();
+
+    // Timestamps come from clock once set, 0 before
+    void begin(Clock &clock) { m_clock = &clock; }
+
+    template <typename... Args>
+    void log(uint8_t level, const char *format, Args... args)
+    {
+        static_assert(sizeof...(Args) <= LogRecord::MAX_ARGS, "too many log arguments");
+        LogRecord record;
+        record.timeUs = m_clock ? m_clock->micros() : 0;
+        record.format = format;
+        record.level = level;
+        record.nargs = sizeof...(Args);
+        LogArg packed[] = { LogArg(), pack(args)... };
+        for (int n = 0; n < record.nargs; n++) record.args[n] = packed[n + 1];
+        push(record);
+    }
+
+    // Format and write up to max queued records, one line per write() call.
+    // Single consumer. Returns the number of records written.
+    size_t drain(void (*write)(const char *line, size_t len), size_t max = CAPACITY);
+
+    uint32_t dropped() const { return m_dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq;
+        LogRecord record;
+    };
+
+    template <typename T>
+    static LogArg pack(T value)
+    {
+        LogArg arg;
+        if (std::is_floating_point<T>::value) {
+            arg.type = LogArg::FLOAT;
+            arg.f = (double)value;
+        } else if (std::is_signed<T>::value) {
+            arg.type = LogArg::INT;
+            arg.i = (long long)value;
+        } else {
+            arg.type = LogArg::UINT;
+            arg.u = (unsigned long long)value;
+        }
+        return arg;
+    }
+
+    template <typename T>
+    static LogArg pack(T *value)
+    {
+        LogArg arg;
+        arg.type = LogArg::PTR;
+        arg.p = value;
+        return arg;
+    }
+
+    void push(const LogRecord &record);
+    static size_t format(char *buf, size_t len, const LogRecord &record);
+
+    Clock *m_clock;
+    Slot m_slots[CAPACITY];
+    std::atomic<uint32_t> m_head; // next slot to claim, any producer
+    uint32_t m_tail;              // next slot to drain, consumer only
+    std::atomic<uint32_t> m_dropped;
+    uint32_t m_reportedDrops;
+};
+
+extern Logger logger;
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <stdint.h>
+
+// Signed fixed point on an int32_t with FRAC fractional bits (Fixed<16> is
+// Q16.16: +-32768 with 1.5e-5 resolution). Products and quotients go through
+// int64_t, and conversions and arithmetic saturate at +-MAX instead of
+// wrapping, so a large gain times a large error clips like a float would
+// against the output limits.
+template <int FRAC>
+class Fixed
+{
+public:
+    static const int32_t ONE = (int32_t)1 << FRAC;
+    static const int32_t MAX = INT32_MAX; // raw; -MAX is the floor, so negation never overflows
+
+    Fixed() : raw(0) {}
+    Fixed(int v) : raw(saturate((int64_t)v * ONE)) {}
+    Fixed(float v) : raw(round(v * ONE)) {}
+    Fixed(double v) : raw(round(v * ONE)) {}
+
+    static Fixed fromRaw(int32_t r) { Fixed f; f.raw = r; return f; }
+
+    explicit operator float() const { return (float)raw / ONE; }
+    explicit operator double() const { return (double)raw / ONE; }
+
+    Fixed operator-() const { return fromRaw(-raw); }
+    Fixed operator+(Fixed o) const { return fromRaw(saturate((int64_t)raw + o.raw)); }
+    Fixed operator-(Fixed o) const { return fromRaw(saturate((int64_t)raw - o.raw)); }
+    Fixed operator*(Fixed o) const { return fromRaw(saturate(((int64_t)raw * o.raw) >> FRAC)); }
+    Fixed operator/(Fixed o) const { return fromRaw(saturate(((int64_t)raw << FRAC) / o.raw)); }
+
+    Fixed &operator+=(Fixed o) { return *this = *this + o; }
+    Fixed &operator-=(Fixed o) { return *this = *this - o; }
+    Fixed &operator*=(Fixed o) { return *this = *this * o; }
+
+    bool operator<(Fixed o) const { return raw < o.raw; }
+    bool operator>(Fixed o) const { return raw > o.raw; }
+    bool operator<=(Fixed o) const { return raw <= o.raw; }
+    bool operator>=(Fixed o) const { return raw >= o.raw; }
+    bool operator==(Fixed o) const { return raw == o.raw; }
+    bool operator!=(Fixed o) const { return raw != o.raw; }
+
+    int32_t raw;
+
+private:
+    static int32_t saturate(int64_t v) { return v > MAX ? MAX : (v < -MAX ? -MAX : (int32_t)v); }
+    // Scaled value to the nearest raw step; 2^31 is exact in float and double
+    template <typename T>
+    static int32_t round(T v) {
+        if (v >= T(2147483648.0)) return MAX;
+        if (v <= T(-2147483648.0)) return -MAX;
+        return saturate((int64_t)(v + (v >= 0 ? T(0.5) : T(-0.5))));
+    }
+};
+
+typedef Fixed<16> Q16;
@@ -1,45 +1,126 @@
 #include "PID.h"
 
-PID::PID(double p, double i, double d, unsigned long *DT):
-    kp(p), ki(i), kd(d), previous_error(0), setpoint(0), DT(DT), integral(0) {}
+#include "Control/Angle.h"
 
-PID::~PID() {}
+template <typename Scalar>
+static Scalar clampTo(Scalar v, Scalar lo, Scalar hi) {
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+template <typename Scalar>
+PID<Scalar>::PID(Scalar p, Scalar i, Scalar d):
+    kp(p), ki(i), kd(d), setpoint(0),
+    outMin(0), outMax(0), limited(false), derivativeTau(0), trackingGain(0), wrapPeriod(0),
+    integral(0), derivative(0), previous_measurement(0), previous_time(0), primed(false),
+    P(0), I(0), D(0) {}
+
+template <typename Scalar>
+PID<Scalar>::~PID() {}
 
-void PID::setP(double p) {
+template <typename Scalar>
+void PID<Scalar>::setP(Scalar p) {
     kp = p;
 }
 
-void PID::setI(double i) {
+template <typename Scalar>
+void PID<Scalar>::setI(Scalar i) {
     ki = i;
 }
-void PID::setD(double d) {
+
+template <typename Scalar>
+void PID<Scalar>::setD(Scalar d) {
     kd = d;
 }
 
-double PID::compute(double measured_value) {
-    double error = setpoint - measured_value;
+template <typename Scalar>
+void PID<Scalar>::setOutputLimits(Scalar min, Scalar max) {
+    outMin = min;
+    outMax = max;
+    limited = true;
+    integral = clampTo(integral, outMin, outMax);
+}
+
+template <typename Scalar>
+void PID<Scalar>::setDerivativeFilter(Scalar tau) {
+    derivativeTau = tau;
+}
+
+template <typename Scalar>
+void PID<Scalar>::setTrackingGain(Scalar gain) {
+    trackingGain = gain;
+}
+
+template <typename Scalar>
+void PID<Scalar>::setWrap(Scalar period) {
+    wrapPeriod = period;
+}
+
+template <typename Scalar>
+Scalar PID<Scalar>::compute(Scalar measured_value, uint32_t nowUs, Scalar feedForward) {
+    const Scalar zero(0);
+    const bool wraps = wrapPeriod > zero;
+    Scalar error = setpoint - measured_value;
+    if (wraps) error = wrapHalf(error, wrapPeriod);
+
+    Scalar dt = zero;
+    if (primed) {
+        dt = Scalar((float)(nowUs - previous_time) * 1e-6f); // wraps correctly on overflow
+    }
+    previous_time = nowUs;
+    primed = true;
+
+    P = kp * error;
 
-    double dt_seconds = (*DT) / 1000000.0; // Convert to seconds but don't modify original DT
+    if (dt > zero) {
+        // ki * dt first: ki * error alone can pass the Q16 range at high gains
+        integral += ki * dt * error;
 
-    double P = kp * error;
+        // d/dt of -measurement, through a first-order low-pass
+        Scalar change = previous_measurement - measured_value;
+        if (wraps) change = wrapHalf(change, wrapPeriod);
+        Scalar raw = kd * change / dt;
+        Scalar alpha = derivativeTau > zero ? dt / (derivativeTau + dt) : Scalar(1);
+        derivative += alpha * (raw - derivative);
+    }
+    previous_measurement = measured_value;
 
-    integral += error * dt_seconds; // Accumulate error over time
-    double I = ki * integral;
+    I = integral;
+    D = derivative;
 
-    if (integral > 255) integral = 255;
-    if (integral < -255) integral = -255;
+    Scalar unsaturated = P + I + D + feedForward;
+    Scalar output = limited ? clampTo(unsaturated, outMin, outMax) : unsaturated;
 
-    double D = kd * (error - previous_error) / (dt_seconds + 1e-6); // Avoid division by zero
+    // Back-calculation: bleed the excess off the integral, at most all of it per step
+    if (output != unsaturated && dt > zero) {
+        Scalar gain = trackingGain;
+        if (gain == zero) gain = kp > zero ? ki / kp : Scalar(1) / dt;
+        Scalar bleed = gain * dt;
+        if (bleed > Scalar(1)) bleed = Scalar(1);
+        integral += bleed * (output - unsaturated);
+        integral = clampTo(integral, outMin, outMax);
+    }
 
-    previous_error = error;
-    return P + I + D;
+    return output;
 }
 
-void PID::reset() {
+template <typename Scalar>
+void PID<Scalar>::reset() {
     integral = 0;
-    previous_error = 0;
+    derivative = 0;
+    primed = false;
+    P = I = D = 0;
 }
 
-void PID::setSetpoint(double newpoint){
+template <typename Scalar>
+void PID<Scalar>::setIntegral(Scalar value) {
+    integral = limited ? clampTo(value, outMin, outMax) : value;
+}
+
+template <typename Scalar>
+void PID<Scalar>::setSetpoint(Scalar newpoint){
     setpoint = newpoint;
-}
\ No newline at end of file
+}
+
+template class PID<float>;
+template class PID<double>;
+template class PID<Q16>;
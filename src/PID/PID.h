@@ -1,20 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include "Fixed.h"
+
+// PID on float, double or fixed point (Q16), instantiated in PID.cpp.
+//
+// - Each controller keeps its own timebase: compute() takes a monotonic
+//   microsecond timestamp and derives dt from the previous call.
+// - The derivative acts on the measurement, not the error, so setpoint steps
+//   do not kick, and is low-pass filtered with time constant derivativeTau.
+// - Output limits with back-calculation anti-windup: when the output
+//   saturates, the integral is pulled back by trackingGain * excess * dt.
+// - With a wrap period (e.g. 360 for a joint that turns freely) the error
+//   and the measurement change are taken the short way round.
+template <typename Scalar>
 class PID{
-    double kp;
-    double ki;
-    double kd;
-    double previous_error;
-    double setpoint;
-    unsigned long *DT;
-    double integral; // Make integral a member variable to avoid static issues
+    Scalar kp;
+    Scalar ki;
+    Scalar kd;
+    Scalar setpoint;
+
+    Scalar outMin;
+    Scalar outMax;
+    bool limited;
+    Scalar derivativeTau;  // s, 0 = unfiltered
+    Scalar trackingGain;   // 1/s, 0 = automatic (ki / kp)
+    Scalar wrapPeriod;     // 0 = no wraparound
+
+    Scalar integral;       // integral term, already scaled by ki
+    Scalar derivative;     // filtered derivative term
+    Scalar previous_measurement;
+    uint32_t previous_time;
+    bool primed;
+
+    Scalar P, I, D;        // terms of the last compute()
 
     public:
-        PID(double p, double i, double d, unsigned long *DT);
+        PID(Scalar p = Scalar(0), Scalar i = Scalar(0), Scalar d = Scalar(0));
         ~PID();
 
-        double compute(double measured_value);
-        void setP(double p);
-        void setI(double i);
-        void setD(double d);
-        void setSetpoint(double setpoint);
-        void reset(); // Add reset function to clear integral
-};
\ No newline at end of file
+        Scalar compute(Scalar measured_value, uint32_t nowUs, Scalar feedForward = Scalar(0));
+        void setP(Scalar p);
+        void setI(Scalar i);
+        void setD(Scalar d);
+        void setSetpoint(Scalar setpoint);
+        void setOutputLimits(Scalar min, Scalar max);
+        void setDerivativeFilter(Scalar tau);
+        void setTrackingGain(Scalar gain);
+        void setWrap(Scalar period);
+        void reset(); // clear integral, derivative and timebase
+        void setIntegral(Scalar value); // start the I-term at value, e.g. a known holding output
+
+        Scalar getSetpoint() const { return setpoint; }
+        Scalar pTerm() const { return P; }
+        Scalar iTerm() const { return I; }
+        Scalar dTerm() const { return D; }
+};
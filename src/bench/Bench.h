@@ -0,0 +1,53 @@
+#pragma once
+
+// Minimal host micro-benchmark helpers for the bench_* environments.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <chrono>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// Keeps the compiler from optimising a benchmarked result away.
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Time-stamp counter where the host has one, 0 elsewhere.
+inline uint64_t cycleCount()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+struct BenchResult
+{
+    double nsPerIter;
+    double cyclesPerIter;
+};
+
+template <typename Body>
+BenchResult bench(long iterations, Body &&body)
+{
+    for (long i = 0; i < iterations / 10; i++) body(i); // warm up
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t c0 = cycleCount();
+    for (long i = 0; i < iterations; i++) body(i);
+    uint64_t c1 = cycleCount();
+    double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    return BenchResult{ns / iterations, (double)(c1 - c0) / iterations};
+}
+
+inline void printResult(const char *name, const BenchResult &result, const char *extra = "")
+{
+    printf("%-36s %8.2f ns %8.1f cycles  %s\n", name, result.nsPerIter, result.cyclesPerIter, extra);
+}
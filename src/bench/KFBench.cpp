@@ -0,0 +1,74 @@
+// predict()+update() cost of the Kalman filter variants in kf.h, and how far
+// each drifts from the original double/Eigen path on the same input.
+//
+//   pio run -e bench_kf && .pio/build/bench_kf/program [iterations]
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include <kf.h>
+#include "Bench.h"
+
+static const double DT = 0.001;         // 1 kHz tick, seconds
+static const double ACCEL_VARIANCE = 1e4;
+static const double MEAS_VARIANCE = 0.01;
+
+// Sine sweep quantised to AS5600 counts
+static std::vector<double> makeInput(long n) {
+    std::vector<double> z(n);
+    for (long i = 0; i < n; i++) {
+        double deg = 90.0 * sin(2 * M_PI * 0.5 * i * DT);
+        z[i] = floor(deg * 4096.0 / 360.0) * 360.0 / 4096.0;
+    }
+    return z;
+}
+
+template <typename Filter>
+static void run(const char *name, Filter filter, const std::vector<double> &z, const std::vector<double> &ref) {
+    typedef decltype(filter.pos()) Scalar;
+    long n = z.size();
+
+    std::vector<double> out(n);
+    for (long i = 0; i < n; i++) {
+        filter.predict(Scalar(DT));
+        filter.update(Scalar(z[i]), Scalar(MEAS_VARIANCE));
+        out[i] = filter.pos();
+    }
+    double maxErr = 0;
+    for (long i = 0; i < n; i++) maxErr = fmax(maxErr, fabs(out[i] - ref[i]));
+
+    BenchResult r = bench(n, [&](long i) {
+        filter.predict(Scalar(DT));
+        filter.update(Scalar(z[i]), Scalar(MEAS_VARIANCE));
+        doNotOptimize(filter.pos());
+    });
+
+    char extra[64];
+    snprintf(extra, sizeof(extra), "max |pos - ref| %.2e deg", maxErr);
+    printResult(name, r, extra);
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+    std::vector<double> z = makeInput(n);
+
+    KF<double, Generic<ConstantVelocity>> reference(0, 0, ACCEL_VARIANCE);
+    std::vector<double> ref(n);
+    for (long i = 0; i < n; i++) {
+        reference.predict(DT);
+        reference.update(z[i], MEAS_VARIANCE);
+        ref[i] = reference.pos();
+    }
+
+    printf("%ld iterations of predict()+update()\n", n);
+    run("Eigen double (original)", KF<double, Generic<ConstantVelocity>>(0, 0, ACCEL_VARIANCE), z, ref);
+    run("Eigen float", KF<float, Generic<ConstantVelocity>>(0, 0, ACCEL_VARIANCE), z, ref);
+    run("closed-form double", KF<double>(0, 0, ACCEL_VARIANCE), z, ref);
+    run("closed-form float", KF<float>(0, 0, ACCEL_VARIANCE), z, ref);
+
+    KF<float> steady(0, 0, ACCEL_VARIANCE);
+    steady.setSteadyState(true);
+    run("closed-form float, steady-state gain", steady, z, ref);
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Cost of one PID::compute() per scalar type, next to the previous
+// double-only controller for reference.
+//
+//   pio run -e bench_pid && .pio/build/bench_pid/program [iterations]
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Control/Joints.h"
+#include "PID/PID.h"
+#include "Bench.h"
+
+static const uint32_t PERIOD_US = 1000;
+
+// The controller as it was before it was templated: double, shared dt,
+// derivative on error, integral clamped after use.
+class LegacyPID {
+    double kp, ki, kd, previous_error, setpoint, integral;
+    unsigned long *DT;
+public:
+    LegacyPID(double p, double i, double d, unsigned long *DT):
+        kp(p), ki(i), kd(d), previous_error(0), setpoint(0), integral(0), DT(DT) {}
+    void setSetpoint(double s) { setpoint = s; }
+    double compute(double measured_value) {
+        double error = setpoint - measured_value;
+        double dt_seconds = (*DT) / 1000000.0;
+        double P = kp * error;
+        integral += error * dt_seconds;
+        double I = ki * integral;
+        if (integral > 255) integral = 255;
+        if (integral < -255) integral = -255;
+        double D = kd * (error - previous_error) / (dt_seconds + 1e-6);
+        previous_error = error;
+        return P + I + D;
+    }
+};
+
+template <typename Scalar>
+static void run(const char *name, const std::vector<float> &meas) {
+    PID<Scalar> pid(Scalar(20.0f), Scalar(15.0f), Scalar(0.5f));
+    pid.setSetpoint(Scalar(45.0f));
+    pid.setOutputLimits(Scalar(-255), Scalar(255));
+    pid.setDerivativeFilter(Scalar(0.005f));
+
+    // Time keeps moving forward across the warm-up and the timed pass
+    long n = meas.size();
+    uint32_t nowUs = 0;
+    BenchResult r = bench(n, [&](long i) {
+        nowUs += PERIOD_US;
+        doNotOptimize(pid.compute(Scalar(meas[i]), nowUs));
+    });
+    printResult(name, r);
+}
+
+// PID<Q16> against PID<float> at a joint's maximum gains, through full-range
+// steps either way: the fixed-point terms must clip, never wrap
+static void checkRange(int joint) {
+    const float *max = JOINTS[joint].maxGains;
+    PID<float> reference(max[0], max[1], max[2]);
+    PID<Q16> fixed((Q16)max[0], (Q16)max[1], (Q16)max[2]);
+    reference.setOutputLimits(-255, 255);
+    fixed.setOutputLimits(Q16(-255), Q16(255));
+
+    float worst = 0;
+    uint32_t nowUs = 0;
+    for (int i = 0; i < 4000; i++) {
+        float setpoint = (i / 1000) % 2 ? -180.0f : 180.0f;
+        float measured = -setpoint * (1.0f - (i % 1000) / 1000.0f);
+        reference.setSetpoint(setpoint);
+        fixed.setSetpoint(Q16(setpoint));
+        nowUs += PERIOD_US;
+        float a = reference.compute(measured, nowUs);
+        float b = (float)fixed.compute(Q16(measured), nowUs);
+        if (fabsf(a - b) > worst) worst = fabsf(a - b);
+    }
+    printf("%-36s %s max gains, worst |Q16 - float| %.2f duty%s\n", "PID<Q16> range", JOINTS[joint].name,
+           worst, worst > 1 ? "  OVERFLOW" : "");
+}
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+
+    std::vector<float> meas(n);
+    for (long i = 0; i < n; i++) meas[i] = 45.0f + 30.0f * sinf(i * 0.001f);
+
+    printf("%ld compute() calls\n", n);
+
+    unsigned long DT = PERIOD_US;
+    LegacyPID legacy(20, 15, 0.5, &DT);
+    legacy.setSetpoint(45);
+    printResult("legacy double PID", bench(n, [&](long i) { doNotOptimize(legacy.compute(meas[i])); }));
+
+    run<double>("PID<double>", meas);
+    run<float>("PID<float>", meas);
+    run<Q16>("PID<Q16>", meas);
+    for (int j = 0; j < JOINT_COUNT; j++) checkRange(j);
+    return 0;
+}
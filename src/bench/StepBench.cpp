@@ -0,0 +1,110 @@
+// Closed-loop step responses of the real control path (Acquisition + KF +
+// ControlLoop + PID) against the DC motor/gearbox/encoder model in
+// native/Plant.h. Prints one line of figures per scenario; the run is
+// deterministic, so a change in any number is a change in behaviour.
+//
+//   pio run -e bench_step && .pio/build/bench_step/program [rate_hz] [seconds]
+//
+// Gains are the web UI defaults, the rate the board's default control rate.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Control/ControlLoop.h"
+#include "native/Plant.h"
+#include "native/StepMetrics.h"
+
+struct Scenario
+{
+    const char *name;
+    int joint;      // 0 arm, 1 wrist
+    float start;    // deg
+    float target;   // deg
+    bool profiled;  // through the default motion profile, else a raw step
+    bool cascade;
+    float offset;   // MotorDriver stiction offset, duty
+    int pwmBits;    // sim motor PWM resolution, 0 = the firmware's
+    int reissueMs;  // the target is commanded again this often, 0 = once
+};
+
+static const Scenario SCENARIOS[] = {
+    {"arm_step",          0,   0,  45, false, false, 0, 0, 0},
+    {"arm_step_8bit",     0,   0,  45, false, false, 0, 8, 0},   // the old 8-bit LEDC
+    {"arm_step_down",     0,  45,   0, false, false, 0, 0, 0},
+    {"arm_move",          0,   0,  45, true,  false, 0, 0, 0},
+    {"arm_move_reissue",  0,   0,  45, true,  false, 0, 0, 5},   // as a 200 Hz stream would
+    {"arm_cascade_step",  0,   0,  45, false, true,  0, 0, 0},
+    {"arm_wrap_step",     0, 170, 190, false, false, 0, 0, 0},   // commanded as -170: through 180
+    {"wrist_step",        1,   0,  30, false, false, 0, 0, 0},
+    {"wrist_step_8bit",   1,   0,  30, false, false, 0, 8, 0},
+    {"wrist_step_offset", 1,   0,  30, false, false, 8, 0, 0},   // breakaway is ~9 duty
+    {"wrist_move",        1,   0,  30, true,  false, 0, 0, 0},
+};
+
+static void run(const Scenario &s, unsigned long period, double seconds) {
+    SimClock clock;
+    DCMotorJoint arm(PlantParams::arm(), s.joint == 0 ? s.start : 0);
+    DCMotorJoint wrist(PlantParams::wrist(), s.joint == 1 ? s.start : 0);
+
+    Encoder *const encoders[JOINT_COUNT] = {&arm.encoder, &wrist.encoder};
+    Motor *const motors[JOINT_COUNT] = {&arm.motor, &wrist.motor};
+
+    Acquisition acquisition(encoders, clock);
+    ControlLoop control(acquisition, motors, clock);
+    acquisition.begin();
+    control.begin();
+
+    control.positionPid[0].setP(20);
+    control.positionPid[0].setI(15);
+    control.positionPid[0].setD(0);
+    control.positionPid[1].setP(2);
+    control.positionPid[1].setI(0);
+    control.positionPid[1].setD(0);
+    if (s.cascade) {
+        control.positionPid[0].setP(10);
+        control.positionPid[0].setI(0);
+        control.velocityPid[0].setP(1.5f);
+        control.velocityPid[0].setI(20);
+        control.setMode(0, ControlLoop::CASCADE);
+    }
+    DCMotorJoint &plant = s.joint == 0 ? arm : wrist;
+    DriveShaping shaping;
+    shaping.offset = s.offset;
+    control.driver[s.joint].setShaping(shaping);
+    if (s.pwmBits) plant.motor.setResolution(s.pwmBits);
+    if (!s.profiled) {
+        // Limits far beyond what the plant can follow: the setpoint jumps
+        for (MotionProfile &profile : control.profile) profile.setLimits(1e6f, 1e9f, 1e12f);
+    }
+
+    // Settle on the start angle first (holding against gravity)
+    long settleTicks = (long)(1.0 * 1e6 / period);
+    long ticks = (long)(seconds * 1e6 / period);
+    StepMetrics metrics(s.start, s.target);
+    for (long i = 0; i < settleTicks + ticks; i++) {
+        bool reissue = i > settleTicks && s.reissueMs && (i - settleTicks) * period % (s.reissueMs * 1000ul) < period;
+        if (i == 0 || i == settleTicks || reissue) {
+            control.moveTo(s.joint, apiAngle(s.joint, i == 0 ? s.start : s.target));
+        }
+        clock.advance(period);
+        arm.advance(period);
+        wrist.advance(period);
+        acquisition.sample();
+        control.step();
+        if (i >= settleTicks) metrics.add((i - settleTicks + 1) * period / 1e6, plant.jointDeg());
+    }
+
+    printf("%-18s %8.3f %10.2f %10.3f %9.3f %9.4f\n", s.name, metrics.riseTime(), metrics.overshoot(),
+           metrics.settlingTime(), metrics.steadyStateError(), metrics.itae());
+}
+
+int main(int argc, char **argv) {
+    unsigned long rate = argc > 1 ? strtoul(argv[1], NULL, 10) : 200;
+    double seconds = argc > 2 ? atof(argv[2]) : 3.0;
+    unsigned long period = 1000000 / rate;
+
+    printf("%lu Hz, %.1f s per step, settling band 2%%, -1 = not reached\n", rate, seconds);
+    printf("%-18s %8s %10s %10s %9s %9s\n", "scenario", "rise_s", "overshoot%", "settling_s", "sse_deg", "itae");
+    for (const Scenario &s : SCENARIOS) run(s, period, seconds);
+    return 0;
+}
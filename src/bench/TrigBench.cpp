@@ -0,0 +1,90 @@
+// Polynomial sin/cos/atan2 (Control/FastMath.h) against libm, alone and
+// inside the arm/wrist inverse kinematics the control task solves every
+// step, with the worst error of each over its input sweep.
+//
+//   pio run -e bench_trig && .pio/build/bench_trig/program [iterations]
+
+#include <math.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Control/Kinematics.h"
+#include "Bench.h"
+
+static const float PI = 3.14159265358979f;
+
+int main(int argc, char **argv) {
+    long n = argc > 1 ? atol(argv[1]) : 1000000;
+
+    // Angles over +-8 pi, atan2 arguments round the unit circle at varying radius
+    std::vector<float> x(n), ay(n), ax(n);
+    for (long i = 0; i < n; i++) {
+        x[i] = -8 * PI + 16 * PI * i / n;
+        float a = 2 * PI * i / n;
+        float r = 0.5f + (i % 7);
+        ay[i] = r * sinf(a);
+        ax[i] = r * cosf(a);
+    }
+
+    double sinErr = 0, atanErr = 0;
+    for (long i = 0; i < n; i++) {
+        float s, c;
+        fastSinCos(x[i], s, c);
+        sinErr = fmax(sinErr, fmax(fabs(s - sin((double)x[i])), fabs(c - cos((double)x[i]))));
+        atanErr = fmax(atanErr, fabs(fastAtan2(ay[i], ax[i]) - atan2((double)ay[i], (double)ax[i])));
+    }
+
+    printf("%ld iterations\n", n);
+    char extra[64];
+    printResult("sinf + cosf", bench(n, [&](long i) {
+        doNotOptimize(sinf(x[i]) + cosf(x[i]));
+    }));
+    snprintf(extra, sizeof(extra), "max error %.2e", sinErr);
+    printResult("fastSinCos", bench(n, [&](long i) {
+        float s, c;
+        fastSinCos(x[i], s, c);
+        doNotOptimize(s + c);
+    }), extra);
+    printResult("atan2f", bench(n, [&](long i) {
+        doNotOptimize(atan2f(ay[i], ax[i]));
+    }));
+    snprintf(extra, sizeof(extra), "max error %.2e rad", atanErr);
+    printResult("fastAtan2", bench(n, [&](long i) {
+        doNotOptimize(fastAtan2(ay[i], ax[i]));
+    }), extra);
+
+    // Tool-tip targets sweeping the reachable annulus, each solved from the
+    // previous solution as the control task does along a line
+    PlanarArm<LibmTrig> reference;
+    PlanarArm<FastTrig> fast;
+    std::vector<PlanarArm<>::Point> targets(n);
+    float inner = fabsf(JOINTS[0].linkLength - JOINTS[1].linkLength) + 1.0f;
+    float outer = reference.reach() - 1.0f;
+    for (long i = 0; i < n; i++) {
+        float a = PI * i / n - PI / 2;
+        float r = inner + (outer - inner) * (0.5f + 0.5f * sinf(0.01f * i));
+        targets[i] = {r * cosf(a), r * sinf(a)};
+    }
+    double ikErr = 0;
+    float refArm = 0, refWrist = 0, fastArm = 0, fastWrist = 0;
+    for (long i = 0; i < n; i++) {
+        bool ok = reference.inverse({targets[i].x, targets[i].y}, refArm, refWrist);
+        if (ok && fast.inverse({targets[i].x, targets[i].y}, fastArm, fastWrist)) {
+            ikErr = fmax(ikErr, fmax(fabs(fastArm - refArm), fabs(fastWrist - refWrist)));
+        }
+        fastArm = refArm;
+        fastWrist = refWrist;
+    }
+
+    float arm = 0, wrist = 0;
+    printResult("inverse kinematics, libm", bench(n, [&](long i) {
+        reference.inverse({targets[i].x, targets[i].y}, arm, wrist);
+        doNotOptimize(arm + wrist);
+    }));
+    snprintf(extra, sizeof(extra), "max joint error %.2e deg", ikErr);
+    printResult("inverse kinematics, fast trig", bench(n, [&](long i) {
+        fast.inverse({targets[i].x, targets[i].y}, arm, wrist);
+        doNotOptimize(arm + wrist);
+    }), extra);
+    return 0;
+}
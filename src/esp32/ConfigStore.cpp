@@ -0,0 +1,40 @@
+#include "ConfigStore.h"
+
+#include "Control/ControlLoop.h"
+
+static const char *NAMESPACE = "robotarm";
+static const char *KEY = "config";
+
+Config Config::defaults() {
+    Config config = {};
+    config.version = VERSION;
+    config.controlRateHz = CONTROL_RATE_HZ;
+    for (int j = 0; j < JOINT_COUNT; j++) {
+        config.offset[j] = JOINTS[j].sensorOffset;
+        config.limits[j][0] = 90.0f;
+        config.limits[j][1] = 360.0f;
+        config.limits[j][2] = 3600.0f;
+        config.shape[j] = MotionProfile::SCURVE;
+        config.mode[j] = ControlLoop::POSITION;
+    }
+    config.outerDivider = ControlLoop::DEFAULT_OUTER_DIVIDER;
+    config.maxVelocity = ControlLoop::DEFAULT_MAX_VELOCITY;
+    return config;
+}
+
+bool ConfigStore::load(Config &config) {
+    if (!m_prefs.begin(NAMESPACE, true)) return false;
+    Config stored;
+    size_t len = m_prefs.getBytes(KEY, &stored, sizeof(stored));
+    m_prefs.end();
+    if (len != sizeof(stored) || stored.version != Config::VERSION) return false;
+    config = stored;
+    return true;
+}
+
+bool ConfigStore::save(const Config &config) {
+    if (!m_prefs.begin(NAMESPACE, false)) return false;
+    size_t len = m_prefs.putBytes(KEY, &config, sizeof(config));
+    m_prefs.end();
+    return len == sizeof(config);
+}
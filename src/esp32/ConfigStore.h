@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Preferences.h>
+
+#include "Control/Joints.h"
+
+// Control rate used until one is stored
+#ifndef CONTROL_RATE_HZ
+#define CONTROL_RATE_HZ 200
+#endif
+
+// Everything that should survive a reset: tuning, calibration and the last
+// commanded targets. Stored as one NVS blob, so boot loads it in one read.
+struct Config
+{
+    static const uint16_t VERSION = 3;
+
+    uint16_t version;
+    uint16_t controlRateHz;
+    // Per joint, indexed like JOINTS
+    float gains[JOINT_COUNT][3];          // P, I, D
+    float velocityGains[JOINT_COUNT][3];  // inner loop in cascade mode
+    float offset[JOINT_COUNT];            // deg, AS5600 offsets
+    float target[JOINT_COUNT];            // deg, last commanded targets
+    float limits[JOINT_COUNT][3];         // profile v, a, j
+    uint8_t shape[JOINT_COUNT];           // MotionProfile::Shape
+    uint8_t mode[JOINT_COUNT];            // ControlLoop::Mode
+    float velocityFF[JOINT_COUNT];
+    float drive[JOINT_COUNT][3];          // deadband, stiction offset, hysteresis (duty)
+    bool brake[JOINT_COUNT];              // idle brakes instead of coasting
+    bool targetsValid;
+    uint8_t outerDivider;
+    float maxVelocity;
+    bool bootDiagnostics;       // run the bus scans once on the next boot
+
+    // Untuned: zero gains, so a fresh board does not move until told to
+    static Config defaults();
+};
+
+class ConfigStore
+{
+public:
+    // Leaves config untouched and returns false if nothing valid is stored
+    bool load(Config &config);
+    bool save(const Config &config);
+
+private:
+    Preferences m_prefs;
+};
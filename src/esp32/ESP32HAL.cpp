@@ -0,0 +1,211 @@
+#include "ESP32HAL.h"
+
+#include "Log/Log.h"
+
+// AS5600 registers: STATUS, then RAW ANGLE and ANGLE, high byte first
+static const uint8_t REG_STATUS = 0x0B;
+static const uint8_t REG_ANGLE = 0x0E;
+static const uint8_t STATUS_MD = 0x20;  // magnet detected
+
+AS5600Encoder::AS5600Encoder(AS5600 &sensor, TwoWire &bus, const char *name):
+    sensor(sensor), bus(bus), name(name), lock(NULL), m_offset(0), m_pointed(false), m_sinceCheck(0),
+    m_primed(false), m_lastRaw(0), m_position(0), m_stats(), m_statsReset(false),
+    m_lockTime(), m_transactionTime() {}
+
+bool AS5600Encoder::begin() {
+    lock = xSemaphoreCreateMutex();
+    if (lock == NULL) return false;
+
+    sensor.begin();
+    sensor.setDirection(AS5600_COUNTERCLOCK_WISE);  //  default, just be explicit.
+    return true;
+}
+
+bool AS5600Encoder::acquire() {
+    uint32_t start = ESP.getCycleCount();
+    BaseType_t taken = xSemaphoreTake(lock, pdMS_TO_TICKS(100));
+    m_lockTime.record(ESP.getCycleCount() - start);
+    if (taken != pdTRUE) {
+        LOG_WARN("Failed to acquire I2C mutex for %s reading", name);
+        return false;
+    }
+    return true;
+}
+
+void AS5600Encoder::release() {
+    xSemaphoreGive(lock);
+}
+
+void AS5600Encoder::setOffset(float degrees) {
+    long counts = lroundf(degrees * 4096.0f / 360.0f) % 4096;
+    m_offset = (uint16_t)(counts < 0 ? counts + 4096 : counts);
+}
+
+void AS5600Encoder::resetCumulative() {
+    m_primed = false;
+    m_position = 0;
+}
+
+// One transaction: the register write (reg >= 0) and the read are joined by a
+// repeated start; reg < 0 reads from wherever the pointer is.
+bool AS5600Encoder::transfer(int reg, uint8_t *buf, uint8_t len) {
+    const uint8_t address = sensor.getAddress();
+    if (reg >= 0) {
+        bus.beginTransmission(address);
+        bus.write((uint8_t)reg);
+        if (bus.endTransmission(false) != 0) return false;
+    }
+    if (bus.requestFrom(address, len) != len) return false;
+    for (uint8_t i = 0; i < len; i++) buf[i] = bus.read();
+    return true;
+}
+
+// Called with the lock held
+bool AS5600Encoder::sample(uint16_t &raw) {
+    if (m_statsReset) {
+        m_stats.reset();
+        m_statsReset = false;
+    }
+
+    uint8_t buf[5];
+    bool ok;
+    const uint32_t start = micros();
+    const uint32_t startCycles = ESP.getCycleCount();
+    if (m_sinceCheck == 0) {
+        // STATUS, RAW ANGLE, ANGLE; the pointer ends past ANGLE
+        ok = transfer(REG_STATUS, buf, 5) && (buf[0] & STATUS_MD);
+        buf[0] = buf[3];
+        buf[1] = buf[4];
+        m_pointed = false;
+        m_stats.checks++;
+    } else {
+        ok = transfer(m_pointed ? -1 : REG_ANGLE, buf, 2);
+        m_pointed = ok;
+    }
+    m_transactionTime.record(ESP.getCycleCount() - startCycles);
+    const uint32_t elapsed = micros() - start;
+
+    m_stats.reads++;
+    m_stats.lastUs = elapsed;
+    m_stats.sumUs += elapsed;
+    if (elapsed > m_stats.maxUs) m_stats.maxUs = elapsed;
+    if (!ok) m_stats.errors++;
+
+    // A failure is followed by a check, so the magnet is confirmed before
+    // angles are trusted again
+    m_sinceCheck = ok && m_sinceCheck + 1 < MAGNET_CHECK_INTERVAL ? m_sinceCheck + 1 : 0;
+    if (ok) raw = (((uint16_t)(buf[0] & 0x0F) << 8 | buf[1]) + m_offset) & 0x0FFF;
+    return ok;
+}
+
+bool AS5600Encoder::readAngle(uint16_t &raw) {
+    if (!acquire()) return false;
+    bool ok = sample(raw);
+    release();
+    return ok;
+}
+
+// Turns are counted here from successive angles, as the library does
+bool AS5600Encoder::readCumulative(int32_t &counts) {
+    uint16_t raw;
+    if (!readAngle(raw)) return false;
+    if (m_primed) {
+        int32_t step = (int32_t)raw - m_lastRaw;
+        if (step > 2048) step -= 4096;
+        else if (step < -2048) step += 4096;
+        m_position += step;
+    }
+    m_lastRaw = raw;
+    m_primed = true;
+    counts = m_position;
+    return true;
+}
+
+AsyncEncoder::AsyncEncoder(Encoder &inner, const char *name):
+    inner(inner), name(name), task(NULL), done(NULL), kind(NONE), pending(false), ok(false), raw(0), counts(0) {}
+
+bool AsyncEncoder::begin(int core, int priority) {
+    done = xSemaphoreCreateBinary();
+    if (done == NULL) return false;
+    return xTaskCreatePinnedToCore(worker, name, 2048, this, priority, &task, core) == pdPASS;
+}
+
+void AsyncEncoder::worker(void *arg) {
+    AsyncEncoder *self = (AsyncEncoder *)arg;
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (self->kind == ANGLE) self->ok = self->inner.readAngle(self->raw);
+        else self->ok = self->inner.readCumulative(self->counts);
+        xSemaphoreGive(self->done);
+    }
+}
+
+// Reads the same register the previous read asked for; the first read of a
+// kind is synchronous.
+void AsyncEncoder::prefetch() {
+    if (task == NULL || kind == NONE || pending) return;
+    pending = true;
+    xTaskNotifyGive(task);
+}
+
+bool AsyncEncoder::collect(Kind wanted) {
+    if (!pending) return false;
+    pending = false;
+    if (xSemaphoreTake(done, pdMS_TO_TICKS(100)) != pdTRUE) {
+        LOG_WARN("%s prefetch timed out", name);
+        return false;
+    }
+    return kind == wanted;
+}
+
+bool AsyncEncoder::readAngle(uint16_t &out) {
+    bool fetched = collect(ANGLE);
+    kind = ANGLE;
+    if (!fetched) return inner.readAngle(out);
+    if (ok) out = raw;
+    return ok;
+}
+
+bool AsyncEncoder::readCumulative(int32_t &out) {
+    bool fetched = collect(CUMULATIVE);
+    kind = CUMULATIVE;
+    if (!fetched) return inner.readCumulative(out);
+    if (ok) out = counts;
+    return ok;
+}
+
+HBridgeMotor::HBridgeMotor(int pwmPin, int in1, int in2, int channel, int freq, int resolution):
+    pwmPin(pwmPin), in1(in1), in2(in2), channel(channel), freq(freq), resolution(resolution),
+    maxDuty((1u << resolution) - 1), pins(REVERSE) {}
+
+void HBridgeMotor::begin() {
+    pinMode(pwmPin, OUTPUT);
+    pinMode(in1, OUTPUT);
+    pinMode(in2, OUTPUT);
+
+    digitalWrite(in1, HIGH);
+    digitalWrite(in2, LOW);
+    pins = REVERSE;
+
+    ledcSetup(channel, freq, resolution);
+    ledcAttachPin(pwmPin, channel);
+    ledcWrite(channel, 0);
+}
+
+void HBridgeMotor::setPins(Drive state) {
+    if (state == pins) return;
+    digitalWrite(in1, state == REVERSE ? HIGH : LOW);
+    digitalWrite(in2, state == FORWARD ? HIGH : LOW);
+    pins = state;
+}
+
+void HBridgeMotor::drive(Drive state, float level) {
+    if (state == COAST) {
+        ledcWrite(channel, 0);
+        return;
+    }
+    setPins(state);
+    if (level < 0) level = 0;
+    if (level > 1) level = 1;
+    ledcWrite(channel, (uint32_t)(level * maxDuty + 0.5f));
+}
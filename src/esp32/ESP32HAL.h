@@ -0,0 +1,143 @@
+#pragma once
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <AS5600.h>
+#include "HAL/HAL.h"
+#include "Control/Metrics.h"
+
+// Bus time of one sensor's reads. Written by the reading task, read by
+// diagnostics; readers may see a torn update.
+struct I2CStats
+{
+    uint32_t reads;     // transactions
+    uint32_t checks;    // of which status + angle bursts
+    uint32_t errors;    // NACKs, short reads and missing magnet
+    uint32_t lastUs;
+    uint32_t maxUs;
+    uint64_t sumUs;
+
+    void reset() { *this = I2CStats(); }
+    float meanUs() const { return reads ? (float)sumUs / reads : 0; }
+};
+
+// AS5600 on its own, already initialised Wire bus. The lock only serialises
+// users of this sensor's bus, so sensors on different buses read in parallel.
+//
+// Reads bypass the library: the AS5600 keeps its register pointer on the
+// ANGLE high byte, so once pointed there a sample is a single 2-byte read
+// with no register write. Every MAGNET_CHECK_INTERVAL samples, and after any
+// failure, STATUS and ANGLE come in one 5-byte burst instead. The zero offset
+// and the turn count are kept here, the library is only used at setup.
+class AS5600Encoder : public Encoder
+{
+public:
+    static const uint16_t MAGNET_CHECK_INTERVAL = 100;
+
+    AS5600Encoder(AS5600 &sensor, TwoWire &bus, const char *name);
+
+    bool begin();
+
+    bool readAngle(uint16_t &raw) override;
+    bool readCumulative(int32_t &counts) override;
+
+    // Zero offset in deg, added to every angle; safe from any task
+    void setOffset(float degrees);
+    // Cumulative counts restart from 0 at the current angle
+    void resetCumulative();
+
+    I2CStats stats() const { return m_stats; }
+    // Picked up by the next read
+    void resetStats() { m_statsReset = true; }
+
+    // CPU cycles waiting for the bus lock, and on the bus per transaction
+    const CycleHistogram &lockTime() const { return m_lockTime; }
+    const CycleHistogram &transactionTime() const { return m_transactionTime; }
+
+private:
+    bool acquire();
+    void release();
+    bool transfer(int reg, uint8_t *buf, uint8_t len);
+    bool sample(uint16_t &raw);
+
+    AS5600 &sensor;
+    TwoWire &bus;
+    const char *name;
+    SemaphoreHandle_t lock;
+
+    volatile uint16_t m_offset;     // counts
+    bool m_pointed;                 // register pointer on ANGLE
+    uint16_t m_sinceCheck;
+    bool m_primed;
+    uint16_t m_lastRaw;
+    int32_t m_position;
+    I2CStats m_stats;
+    volatile bool m_statsReset;
+    CycleHistogram m_lockTime;
+    CycleHistogram m_transactionTime;
+};
+
+// Runs another encoder's reads on a worker task, so prefetch() lets the caller
+// read a sensor on a different bus while this one's transaction is in flight.
+class AsyncEncoder : public Encoder
+{
+public:
+    AsyncEncoder(Encoder &inner, const char *name);
+
+    bool begin(int core, int priority);
+
+    void prefetch() override;
+    bool readAngle(uint16_t &raw) override;
+    bool readCumulative(int32_t &counts) override;
+
+private:
+    enum Kind { NONE, ANGLE, CUMULATIVE };
+
+    static void worker(void *arg);
+    bool collect(Kind kind);
+
+    Encoder &inner;
+    const char *name;
+    TaskHandle_t task;
+    SemaphoreHandle_t done;
+
+    volatile Kind kind;
+    volatile bool pending;
+    bool ok;
+    uint16_t raw;
+    int32_t counts;
+};
+
+// LEDC PWM on the enable pin, two GPIOs for direction. The direction pins
+// are only written when the bridge state changes; coasting just drops the
+// enable PWM, braking drives both pins low with the enable on.
+class HBridgeMotor : public Motor
+{
+public:
+    HBridgeMotor(int pwmPin, int in1, int in2, int channel, int freq, int resolution);
+
+    void begin() override;
+    void drive(Drive state, float level) override;
+
+private:
+    void setPins(Drive state);
+
+    int pwmPin;
+    int in1;
+    int in2;
+    int channel;
+    int freq;
+    int resolution;
+    uint32_t maxDuty;
+    Drive pins;     // what in1/in2 are set for (never COAST)
+};
+
+class ArduinoClock : public Clock
+{
+public:
+    unsigned long micros() override { return ::micros(); }
+    unsigned long millis() override { return ::millis(); }
+
+    uint32_t cycles() override { return ESP.getCycleCount(); }
+    uint64_t cyclesPerSecond() override { return (uint64_t)ESP.getCpuFreqMHz() * 1000000u; }
+};
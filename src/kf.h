@@ -1,52 +1,94 @@
 #pragma once
 
+#include <cmath>
+
+#ifdef ARDUINO
 #include <ArduinoEigenDense.h>
+#else
+#include <Eigen/Dense>
+#endif
 
-class KF
+// Position/velocity state driven by white acceleration noise, position measured.
+struct ConstantVelocity
 {
-public:
     static const int NUM_VARS = 2;
     static const int iX = 0;
     static const int iV = 1;
 
-    using Vector = Eigen::Matrix<double, NUM_VARS, 1>;
-    using Matrix = Eigen::Matrix<double, NUM_VARS, NUM_VARS>;
+    template <typename Scalar>
+    static Eigen::Matrix<Scalar, NUM_VARS, NUM_VARS> transition(Scalar dt)
+    {
+        Eigen::Matrix<Scalar, NUM_VARS, NUM_VARS> F = Eigen::Matrix<Scalar, NUM_VARS, NUM_VARS>::Identity();
+        F(iX, iV) = dt;
+        return F;
+    }
+
+    template <typename Scalar>
+    static Eigen::Matrix<Scalar, NUM_VARS, 1> noise(Scalar dt)
+    {
+        Eigen::Matrix<Scalar, NUM_VARS, 1> G;
+        G(iX) = Scalar(0.5) * dt * dt;
+        G(iV) = dt;
+        return G;
+    }
 
-    KF(double initialX, double initialV, double accelVariance) : m_accelVariance(accelVariance)
+    template <typename Scalar>
+    static Eigen::Matrix<Scalar, 1, NUM_VARS> measurement()
     {
+        Eigen::Matrix<Scalar, 1, NUM_VARS> H;
+        H.setZero();
+        H(0, iX) = 1;
+        return H;
+    }
+};
+
+// Same model without the closed-form specialisation, i.e. the Eigen path.
+// For benchmarks and cross-checking.
+template <typename Model>
+struct Generic : Model {};
+
+// Kalman filter on Eigen fixed-size matrices, for any Model with transition(),
+// noise() and measurement().
+template <typename Scalar = double, typename Model = ConstantVelocity>
+class KF
+{
+public:
+    static const int NUM_VARS = Model::NUM_VARS;
+    static const int iX = Model::iX;
+    static const int iV = Model::iV;
+
+    using Vector = Eigen::Matrix<Scalar, NUM_VARS, 1>;
+    using Matrix = Eigen::Matrix<Scalar, NUM_VARS, NUM_VARS>;
+
+    KF(Scalar initialX, Scalar initialV, Scalar accelVariance) : m_accelVariance(accelVariance)
+    {
+        m_mean.setZero();
         m_mean(iX) = initialX;
         m_mean(iV) = initialV;
 
         m_cov.setIdentity();
     }
 
-    void predict(double dt)
+    void predict(Scalar dt)
     {
-        Matrix stateTransition = Matrix::Identity();
-        stateTransition(iX, iV) = dt;
+        const Matrix stateTransition = Model::transition(dt);
+        const Vector G = Model::noise(dt);
 
         const Vector newX = stateTransition * m_mean;
-
-        Vector G;
-        G(iX) = 0.5 * dt * dt;
-        G(iV) = dt;
-
         const Matrix newP = stateTransition * m_cov * stateTransition.transpose() + G * G.transpose() * m_accelVariance;
 
         m_cov = newP;
         m_mean = newX;
     }
 
-    void update(double measValue, double measVariance)
+    void update(Scalar measValue, Scalar measVariance)
     {
-        Eigen::Matrix<double, 1, NUM_VARS> H;
-        H.setZero();
-        H(0, iX) = 1;
+        const Eigen::Matrix<Scalar, 1, NUM_VARS> H = Model::template measurement<Scalar>();
 
-        const double y = measValue - H * m_mean;
-        const double S = H * m_cov * H.transpose() + measVariance;
+        const Scalar y = measValue - H * m_mean;
+        const Scalar S = H * m_cov * H.transpose() + measVariance;
 
-        const Vector K = m_cov * H.transpose() * 1.0 / S;
+        const Vector K = m_cov * H.transpose() * (Scalar(1) / S);
 
         Vector newX = m_mean + K * y;
         Matrix newP = (Matrix::Identity() - K * H) * m_cov;
@@ -65,12 +107,12 @@ public:
         return m_mean;
     }
 
-    double pos() const
+    Scalar pos() const
     {
         return m_mean(iX);
     }
 
-    double vel() const
+    Scalar vel() const
     {
         return m_mean(iV);
     }
@@ -79,5 +121,146 @@ private:
     Vector m_mean;
     Matrix m_cov;
 
-    const double m_accelVariance;
+    const Scalar m_accelVariance;
+};
+
+// Closed-form constant-velocity filter: the same equations as the Eigen path
+// written out on the three distinct covariance terms, with no temporaries.
+//
+// With setSteadyState(true) the gain is frozen once it stops changing, after
+// which predict()/update() only propagate the mean. The covariance resumes if
+// dt or the measurement variance move away from the values it converged at.
+template <typename Scalar>
+class KF<Scalar, ConstantVelocity>
+{
+public:
+    static const int NUM_VARS = ConstantVelocity::NUM_VARS;
+    static const int iX = ConstantVelocity::iX;
+    static const int iV = ConstantVelocity::iV;
+
+    using Vector = Eigen::Matrix<Scalar, NUM_VARS, 1>;
+    using Matrix = Eigen::Matrix<Scalar, NUM_VARS, NUM_VARS>;
+
+    static const int STEADY_UPDATES = 8; // consecutive converged updates before freezing
+
+    KF(Scalar initialX, Scalar initialV, Scalar accelVariance) :
+        m_x(initialX), m_v(initialV), m_p00(1), m_p01(0), m_p11(1),
+        m_k0(0), m_k1(0), m_accelVariance(accelVariance),
+        m_steadyEnabled(false), m_steady(false), m_converged(0),
+        m_gainTolerance(0), m_dtTolerance(0), m_dt(0), m_measVariance(0) {}
+
+    void setSteadyState(bool enable, Scalar gainTolerance = Scalar(1e-4), Scalar dtTolerance = Scalar(0.01))
+    {
+        m_steadyEnabled = enable;
+        m_gainTolerance = gainTolerance;
+        m_dtTolerance = dtTolerance;
+        m_steady = false;
+        m_converged = 0;
+    }
+
+    void predict(Scalar dt)
+    {
+        m_x += dt * m_v;
+
+        if (m_steady) {
+            if (std::abs(dt - m_dt) <= m_dtTolerance * m_dt) return;
+            m_steady = false;
+            m_converged = 0;
+        }
+        m_dt = dt;
+
+        // P = F P F' + G G' q
+        const Scalar dt2 = dt * dt;
+        const Scalar q = m_accelVariance;
+        m_p00 += dt * (2 * m_p01 + dt * m_p11) + q * dt2 * dt2 * Scalar(0.25);
+        m_p01 += dt * m_p11 + q * dt2 * dt * Scalar(0.5);
+        m_p11 += q * dt2;
+    }
+
+    void update(Scalar measValue, Scalar measVariance)
+    {
+        if (m_steady && measVariance != m_measVariance) {
+            m_steady = false;
+            m_converged = 0;
+        }
+
+        if (!m_steady) {
+            const Scalar s = m_p00 + measVariance;
+            const Scalar k0 = m_p00 / s;
+            const Scalar k1 = m_p01 / s;
+
+            // P = (I - K H) P
+            m_p11 -= k1 * m_p01;
+            m_p01 -= k0 * m_p01;
+            m_p00 -= k0 * m_p00;
+
+            trackConvergence(k0, k1, measVariance);
+            m_k0 = k0;
+            m_k1 = k1;
+        }
+
+        const Scalar y = measValue - m_x;
+        m_x += m_k0 * y;
+        m_v += m_k1 * y;
+    }
+
+    Matrix cov() const
+    {
+        Matrix P;
+        P << m_p00, m_p01,
+             m_p01, m_p11;
+        return P;
+    }
+
+    Vector mean() const
+    {
+        return Vector(m_x, m_v);
+    }
+
+    Scalar pos() const
+    {
+        return m_x;
+    }
+
+    Scalar vel() const
+    {
+        return m_v;
+    }
+
+    bool steady() const
+    {
+        return m_steady;
+    }
+
+private:
+    void trackConvergence(Scalar k0, Scalar k1, Scalar measVariance)
+    {
+        if (!m_steadyEnabled) return;
+
+        const bool settled = std::abs(k0 - m_k0) <= m_gainTolerance * std::abs(k0) &&
+                             std::abs(k1 - m_k1) <= m_gainTolerance * std::abs(k1);
+        m_converged = settled ? m_converged + 1 : 0;
+        if (m_converged >= STEADY_UPDATES) {
+            m_steady = true;
+            m_measVariance = measVariance;
+        }
+    }
+
+    Scalar m_x;
+    Scalar m_v;
+    Scalar m_p00;
+    Scalar m_p01;
+    Scalar m_p11;
+    Scalar m_k0;
+    Scalar m_k1;
+
+    const Scalar m_accelVariance;
+
+    bool m_steadyEnabled;
+    bool m_steady;
+    int m_converged;
+    Scalar m_gainTolerance;
+    Scalar m_dtTolerance;
+    Scalar m_dt;
+    Scalar m_measVariance;
 };
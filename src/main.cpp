@@ -5,7 +5,23 @@
 #include <WiFi.h>
 #include <AsyncTCP.h>
 #include <ESPAsyncWebServer.h>
+#include <AsyncUDP.h>
 #include <kf.h>
+#include <array>
+#include <utility>
+#include "Control/Capture.h"
+#include "Control/Commands.h"
+#include "Control/ControlMetrics.h"
+#include "Control/ControlLoop.h"
+#include "Control/LoopStats.h"
+#include "Control/Teleop.h"
+#include "Control/Telemetry.h"
+#include "esp32/ConfigStore.h"
+#include "esp32/ESP32HAL.h"
+#include "Log/Log.h"
+// Web UI, gzipped at build time from ui/index.html by scripts/compress_ui.py:
+// index_html_gz[], INDEX_HTML_GZ_LEN and INDEX_HTML_ETAG
+#include "index_html_gz.h"
 
 // WiFi credentials - CHANGE THESE TO YOUR NETWORK
 const char* ssid = "Rob-Arm";         // Replace with your WiFi name
@@ -13,599 +29,317 @@ const char* password = "mypasswordisgood"; // Replace with your WiFi password
 
 // Create AsyncWebServer object on port 80
 AsyncWebServer server(80);
+AsyncWebSocket ws("/ws");
 
-// Safety timeout variables
+// Safety timeout variables: the teleop deadman holds the joints once no
+// command has arrived for COMMAND_TIMEOUT
 unsigned long lastCommandTime = 0;
 const unsigned long COMMAND_TIMEOUT = 2000; // 2 seconds timeout
-bool safetyActive = false;
-
-// I2C synchronization variables
-SemaphoreHandle_t i2cMutex;
-bool i2cBusLocked = false;
-
-#define ARM_SENSOR_SDA GPIO_NUM_16
-#define ARM_SENSOR_SCL GPIO_NUM_17
-#define ARM_WIRE Wire.begin(ARM_SENSOR_SDA,ARM_SENSOR_SCL);
-
-#define END Wire.end();
-
-#define WRIST_SENSOR_SDA GPIO_NUM_21
-#define WRIST_SENSOR_SCL GPIO_NUM_22
-#define WRIST_WIRE Wire.begin(WRIST_SENSOR_SDA,WRIST_SENSOR_SCL);
-
-
-#define Motor0 GPIO_NUM_25
-#define Motor0A1 GPIO_NUM_32
-#define Motor0A2 GPIO_NUM_33
-
-#define Motor1 GPIO_NUM_26
-#define Motor1A1 GPIO_NUM_18
-#define Motor1A2 GPIO_NUM_27
+volatile bool safetyActive = false;
+
+// Joystick teleop: UDP setpoint stream, see Control/Teleop.h
+#define TELEOP_PORT 4210
+AsyncUDP teleopUdp;
+TeleopReceiver teleop;
+volatile bool teleopActive = false;
+
+// Pins, buses, PWM and per-joint constants are in Control/Joints.h
+
+// Control task rate (Config::controlRateHz) is rounded to whole FreeRTOS ticks,
+// 1 kHz max with the default tick
+#define CONTROL_TASK_PRIORITY 10
+#define CONTROL_TASK_STACK 4096
+// Sampling pre-empts the controller on the app core, so snapshot readers never stall it
+#define ACQUISITION_TASK_PRIORITY 11
+#define ACQUISITION_TASK_STACK 4096
+// Formats and prints LOG_* records next to the network stack, below everything else
+#define LOG_TASK_PRIORITY 1
+#define LOG_TASK_STACK 3072
+#define LOG_DRAIN_MS 20
+// Live telemetry over /ws: default rate (capped at the control rate) and how
+// often queued ticks are batched into one frame
+#define TELEMETRY_RATE_HZ 50
+#define TELEMETRY_FRAME_MS 50
+
+// One controller per entry of I2C_BUSES: each bus is set up once and has its own lock
+TwoWire *const i2cBuses[] = { &Wire, &Wire1 };
+static_assert(sizeof(i2cBuses) / sizeof(i2cBuses[0]) == sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]),
+              "one TwoWire per I2C_BUSES entry");
+
+// One T per joint, built in place from make(JOINTS[j], j): the HAL devices
+// hold references to each other, so they are never copied
+template <typename T, typename Make, size_t... J>
+std::array<T, JOINT_COUNT> perJoint(Make make, std::index_sequence<J...>) {
+  return {{ make(JOINTS[J], J)... }};
+}
 
-//#define Motor1 GPIO_NUM_17
+template <typename T, typename Make>
+std::array<T, JOINT_COUNT> perJoint(Make make) {
+  return perJoint<T>(make, std::make_index_sequence<JOINT_COUNT>());
+}
 
-#define I2C_Speed 1e5
+std::array<AS5600, JOINT_COUNT> sensors = perJoint<AS5600>([](const JointDescriptor &joint, size_t) {
+  return AS5600(i2cBuses[joint.bus]);
+});
+
+// Tuning, calibration and targets, restored from NVS at boot. Handlers update
+// it and loop() writes it back once changes have settled.
+#define CONFIG_SAVE_DELAY_MS 2000
+Config config = Config::defaults();
+ConfigStore configStore;
+volatile bool configDirty = false;
+volatile unsigned long configChangedAt = 0;
+
+std::array<AS5600Encoder, JOINT_COUNT> sensorEncoders = perJoint<AS5600Encoder>([](const JointDescriptor &joint, size_t j) {
+  return AS5600Encoder(sensors[j], *i2cBuses[joint.bus], joint.name);
+});
+// Joint 0 is read in-line by the acquisition task, every other joint by a
+// worker of its own (started in setup()), so the buses are read in parallel
+std::array<AsyncEncoder, JOINT_COUNT> encoders = perJoint<AsyncEncoder>([](const JointDescriptor &joint, size_t j) {
+  return AsyncEncoder(sensorEncoders[j], joint.name);
+});
+std::array<HBridgeMotor, JOINT_COUNT> motors = perJoint<HBridgeMotor>([](const JointDescriptor &joint, size_t) {
+  return HBridgeMotor(joint.pwmPin, joint.in1Pin, joint.in2Pin, joint.ledcChannel, PWM_FREQUENCY_HZ,
+                      PWM_RESOLUTION_BITS);
+});
+std::array<Encoder *, JOINT_COUNT> encoderPtrs = perJoint<Encoder *>([](const JointDescriptor &, size_t j) -> Encoder * {
+  return &encoders[j];
+});
+std::array<Motor *, JOINT_COUNT> motorPtrs = perJoint<Motor *>([](const JointDescriptor &, size_t j) -> Motor * {
+  return &motors[j];
+});
+ArduinoClock arduinoClock;
+
+Acquisition acquisition(encoderPtrs.data(), arduinoClock);
+ControlLoop control(acquisition, motorPtrs.data(), arduinoClock);
+
+TaskHandle_t acquisitionTaskHandle = NULL;
+TaskHandle_t controlTaskHandle = NULL;
+volatile TickType_t controlPeriodTicks = 1;
+volatile bool controlStatsReset = false;
+volatile bool acquisitionStatsReset = false;
+LoopStats controlStats;
+LoopStats acquisitionStats;
+// Web handler durations (async_tcp task) and how long each Wire.begin() took,
+// in CPU cycles, for /metrics
+CycleHistogram webHandlerTime;
+uint32_t busInitCycles[sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0])];
+
+// Binary waypoint uploads are decoded straight into the control loop's ring
+WaypointDecoder waypointDecoder(control.trajectory);
+AsyncWebServerRequest *trajectoryUpload = NULL;
+
+Telemetry telemetry;
+uint32_t telemetryHz = TELEMETRY_RATE_HZ;
+uint8_t telemetryFrame[Telemetry::HEADER_SIZE + 24 * Telemetry::RECORD_SIZE];
+
+// Every control tick around a trigger, downloaded from /captureData
+Capture capture;
+
+void markConfigDirty() {
+  configChangedAt = millis();
+  configDirty = true;
+}
 
-#define freq 5000 // Hz
-#define resolution 8 // bits
+void storeValues(float *values, float a, float b, float c) {
+  values[0] = a;
+  values[1] = b;
+  values[2] = c;
+}
 
-unsigned long DT,CT,PT,ET; // Loop time in ms
+void applyGains(int joint, bool velocity, const float *gains) {
+  control.setGains(joint, velocity, gains[0], gains[1], gains[2]);
+}
 
-PID m0(0,0,0,&DT);
-PID m1(0,0,0,&DT);
+// Output shaping of one joint as stored in the configuration
+DriveShaping driveShaping(int joint) {
+  DriveShaping shaping;
+  shaping.deadband = config.drive[joint][0];
+  shaping.offset = config.drive[joint][1];
+  shaping.hysteresis = config.drive[joint][2];
+  shaping.brake = config.brake[joint];
+  return shaping;
+}
 
-AS5600 Arm;
-AS5600 Wrist;
+// Push the configuration into the controller; targets only if some were stored
+void applyConfig() {
+  control.setCascade(config.maxVelocity, config.outerDivider);
+  for (int j = 0; j < JOINT_COUNT; j++) {
+    applyGains(j, false, config.gains[j]);
+    applyGains(j, true, config.velocityGains[j]);
+    control.setProfile(j, config.limits[j][0], config.limits[j][1], config.limits[j][2],
+                       (MotionProfile::Shape)config.shape[j]);
+    control.velocityFF[j] = config.velocityFF[j];
+    control.driver[j].setShaping(driveShaping(j));
+    control.setMode(j, (ControlLoop::Mode)config.mode[j]);
+    if (config.targetsValid) control.moveTo(j, config.target[j]);
+  }
+}
 
-float armOffset = -33.0f;
-float wristOffset = 0.0f;
+// Joint from a request parameter: a JOINTS name or an index; -1 if neither
+int jointParam(AsyncWebServerRequest *request, const char *name = "joint") {
+  String value = request->getParam(name, true)->value();
+  int joint = jointIndex(value.c_str());
+  if (joint < 0 && isdigit((unsigned char)value.c_str()[0])) joint = value.toInt();
+  return joint < JOINT_COUNT ? joint : -1;
+}
 
-static int wristRotations{};
+float clampAngle(int joint, float angle) {
+  return constrain(angle, JOINTS[joint].minAngle, JOINTS[joint].maxAngle);
+}
 
-KF KFArm(0,0,0.5);
+// New setpoint for one joint, remembered as the boot target
+void setTarget(int joint, float angle) {
+  control.moveTo(joint, angle);
+  config.target[joint] = angle;
+  config.targetsValid = true;
+}
 
-// Safe I2C reading functions with mutex protection
-float readArmAngleSafe() {
-  float angle = 0;
-  if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    ARM_WIRE
-    if (Arm.detectMagnet()) {
-      angle = fmod((Arm.readAngle() / 4096.0f * 360.0f), 360.0f) - 180.0f;
+TickType_t rateToTicks(uint32_t hz) {
+  hz = constrain(hz, 1, configTICK_RATE_HZ);
+  return configTICK_RATE_HZ / hz;
+}
 
-      Serial.println("Angle Before KF: ");
-      Serial.println(angle);
+// Keep every n-th control step so telemetry runs at (at most) telemetryHz
+void updateTelemetryDecimation() {
+  if (telemetryHz == 0) {
+    telemetry.setDecimation(0);
+    return;
+  }
+  uint32_t controlHz = configTICK_RATE_HZ / controlPeriodTicks;
+  uint32_t decimation = (controlHz + telemetryHz - 1) / telemetryHz;
+  telemetry.setDecimation(decimation > 0 ? decimation : 1);
+}
 
-      KFArm.predict(DT);
-      KFArm.update(angle,0.5);
+// Fixed-rate acquisition task: the only code that touches the encoders. Each
+// published snapshot wakes the control task, so control runs at the same rate
+// on fresh data.
+void acquisitionTask(void *) {
+  TickType_t lastWake = xTaskGetTickCount();
+  unsigned long prev = micros();
+  for (;;) {
+    vTaskDelayUntil(&lastWake, controlPeriodTicks);
+    unsigned long start = micros();
+
+    acquisition.sample();
+    xTaskNotifyGive(controlTaskHandle);
+
+    if (acquisitionStatsReset) {
+      acquisitionStats.reset(controlPeriodTicks * portTICK_PERIOD_MS * 1000);
+      acquisitionStatsReset = false;
+    } else {
+      acquisitionStats.record(start - prev, micros() - start);
+    }
+    prev = start;
+  }
+}
 
-      angle = KFArm.pos();
+// Control task, pinned to the app core next to acquisition. If no sample
+// arrives the controller still runs and ControlLoop cuts the stale joints.
+void controlTask(void *) {
+  unsigned long prev = micros();
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, 2 * controlPeriodTicks);
+    unsigned long start = micros();
+
+    control.step();
+    telemetry.record(control.lastTick());
+    capture.record(control.lastTick());
+
+    if (controlStatsReset) {
+      controlStats.reset(controlPeriodTicks * portTICK_PERIOD_MS * 1000);
+      controlStatsReset = false;
+    } else {
+      controlStats.record(start - prev, micros() - start);
+    }
+    prev = start;
+  }
+}
 
-      Serial.println("Angle After KF: ");
-      Serial.println(angle);
+void writeLog(const char *line, size_t len) {
+  Serial.write((const uint8_t *)line, len);
+}
 
-    }
-    Wire.end();
-    xSemaphoreGive(i2cMutex);
-  } else {
-    Serial.println("Failed to acquire I2C mutex for ARM reading");
+// The only place LOG_* output reaches the UART
+void logTask(void *) {
+  for (;;) {
+    logger.drain(writeLog);
+    vTaskDelay(pdMS_TO_TICKS(LOG_DRAIN_MS));
   }
-  return angle;
 }
 
-float readWristAngleSafe() {
-  float angle = 0;
-  if (xSemaphoreTake(i2cMutex, pdMS_TO_TICKS(100)) == pdTRUE) {
-    WRIST_WIRE
-    if (Wrist.detectMagnet()) {
-      angle =(Wrist.getCumulativePosition() / 4096.0f * 360.0f)/4.5f;
-    }
-    Wire.end();
-    xSemaphoreGive(i2cMutex);
-  } else {
-    Serial.println("Failed to acquire I2C mutex for WRIST reading");
+// Binary commands from /ws, same ranges as the HTTP handlers. Gains change
+// without resetting the controller, so tuning does not bump the joint.
+CommandProtocol::Status handleCommand(const Command &cmd) {
+  int j = cmd.joint;
+  switch (cmd.type) {
+  case Command::SETPOINT:
+    setTarget(j, clampAngle(j, cmd.value[0]));
+    break;
+  case Command::GAINS: {
+    if (cmd.option > 1) return CommandProtocol::BAD_VALUE;
+    bool velocity = cmd.option == 1;
+    const float *max = velocity ? MAX_VELOCITY_GAINS : JOINTS[j].maxGains;
+    float *gains = velocity ? config.velocityGains[j] : config.gains[j];
+    storeValues(gains, constrain(cmd.value[0], 0, max[0]), constrain(cmd.value[1], 0, max[1]),
+               constrain(cmd.value[2], 0, max[2]));
+    applyGains(j, velocity, gains);
+    break;
+  }
+  case Command::LIMITS: {
+    if (cmd.option > 1) return CommandProtocol::BAD_VALUE;
+    float *limits = config.limits[j];
+    storeValues(limits, constrain(cmd.value[0], 1, 2000), constrain(cmd.value[1], 1, 100000),
+               constrain(cmd.value[2], 1, 1000000));
+    config.shape[j] = cmd.option == 0 ? MotionProfile::TRAPEZOIDAL : MotionProfile::SCURVE;
+    control.setProfile(j, limits[0], limits[1], limits[2], (MotionProfile::Shape)config.shape[j]);
+    break;
+  }
+  case Command::MODE:
+    if (cmd.option > ControlLoop::CASCADE) return CommandProtocol::BAD_VALUE;
+    control.setMode(j, (ControlLoop::Mode)cmd.option);
+    config.mode[j] = cmd.option;
+    break;
+  case Command::ESTOP:
+    control.stop();
+    capture.trigger(Capture::EMERGENCY_STOP);
+    LOG_WARN("EMERGENCY STOP ACTIVATED!");
+    break;
   }
-  return angle;
+  if (cmd.type != Command::ESTOP) markConfigDirty();
+  lastCommandTime = millis();
+  return CommandProtocol::OK;
 }
 
-// HTML page content
-const char index_html[] PROGMEM = R"rawliteral(
-<!DOCTYPE HTML>
-<html>
-<head>
-  <title>Motor PID Control</title>
-  <meta name="viewport" content="width=device-width, initial-scale=1">
-  <meta charset="utf-8">
-  <style>
-    @import url('https://fonts.googleapis.com/css2?family=Orbitron:wght@400;700;900&display=swap');
-    
-    * {
-      box-sizing: border-box;
-    }
-    
-    body {
-      font-family: 'Orbitron', monospace;
-      text-align: center; 
-      margin: 0;
-      padding: 20px;
-      min-height: 100vh;
-      color: #E0F2FE;
-      background: linear-gradient(135deg, #1E3A8A 0%, #3B82F6 50%, #06B6D4 100%);
-    }
-    
-    .container {
-      max-width: 800px;
-      margin: 0 auto;
-      background: rgba(0, 0, 0, 0.2);
-      border-radius: 20px;
-      padding: 30px;
-      backdrop-filter: blur(10px);
-      border: 1px solid rgba(255, 255, 255, 0.1);
-    }
-    
-    h1 {
-      color: #FFF;
-      margin-bottom: 30px;
-      font-weight: 900;
-      text-shadow: 0 0 20px #00FFFF;
-    }
-    
-    .motor-section {
-      background: rgba(255, 255, 255, 0.1);
-      border-radius: 15px;
-      padding: 25px;
-      margin: 20px 0;
-      border: 1px solid rgba(255, 255, 255, 0.2);
-    }
-    
-    .motor-title {
-      font-size: 1.5em;
-      font-weight: 700;
-      margin-bottom: 20px;
-      color: #00FFFF;
-    }
-    
-    .control-group {
-      display: grid;
-      grid-template-columns: 1fr 1fr 1fr;
-      gap: 20px;
-      margin: 20px 0;
-    }
-    
-    .pid-group {
-      background: rgba(0, 0, 0, 0.3);
-      border-radius: 10px;
-      padding: 15px;
-    }
-    
-    label {
-      display: block;
-      margin-bottom: 8px;
-      font-weight: 700;
-      color: #FFF;
-    }
-    
-    input[type="number"], input[type="range"] {
-      width: 100%;
-      padding: 8px;
-      border: none;
-      border-radius: 5px;
-      background: rgba(255, 255, 255, 0.9);
-      color: #000;
-      font-family: 'Orbitron', monospace;
-    }
-    
-    .angle-control {
-      grid-column: span 3;
-      background: rgba(0, 100, 200, 0.3);
-      border-radius: 10px;
-      padding: 20px;
-      margin: 20px 0;
-    }
-    
-    .slider-container {
-      margin: 15px 0;
-    }
-    
-    input[type="range"] {
-      height: 8px;
-      background: linear-gradient(90deg, #FF0000, #FFFF00, #00FF00, #00FFFF, #0000FF, #FF00FF, #FF0000);
-      border-radius: 5px;
-      outline: none;
-    }
-    
-    input[type="range"]::-webkit-slider-thumb {
-      appearance: none;
-      width: 20px;
-      height: 20px;
-      border-radius: 50%;
-      background: #FFF;
-      cursor: pointer;
-      box-shadow: 0 0 10px rgba(0, 255, 255, 0.5);
-    }
-    
-    .angle-display {
-      font-size: 1.2em;
-      font-weight: 700;
-      color: #00FFFF;
-      margin: 10px 0;
-    }
-    
-    .button {
-      background: linear-gradient(45deg, #00FFFF, #0080FF);
-      color: #000;
-      border: none;
-      padding: 12px 25px;
-      border-radius: 25px;
-      cursor: pointer;
-      font-family: 'Orbitron', monospace;
-      font-weight: 700;
-      font-size: 1em;
-      margin: 10px;
-      transition: all 0.3s ease;
-      box-shadow: 0 4px 15px rgba(0, 255, 255, 0.3);
-    }
-    
-    .button:hover {
-      transform: translateY(-2px);
-      box-shadow: 0 6px 20px rgba(0, 255, 255, 0.5);
-    }
-    
-    .status {
-      background: rgba(0, 0, 0, 0.5);
-      border-radius: 10px;
-      padding: 15px;
-      margin: 20px 0;
-    }
-    
-    .current-values {
-      display: grid;
-      grid-template-columns: 1fr 1fr;
-      gap: 20px;
-      margin: 20px 0;
-    }
-    
-    .value-display {
-      background: rgba(0, 0, 0, 0.3);
-      border-radius: 8px;
-      padding: 10px;
-    }
-    
-    @media (max-width: 768px) {
-      .control-group {
-        grid-template-columns: 1fr;
-      }
-      .current-values {
-        grid-template-columns: 1fr;
-      }
-    }
-  </style>
-</head>
-<body>
-  <div class="container">
-    <h1>🤖 Motor PID Control System</h1>
-    
-    <!-- ARM Motor Section -->
-    <div class="motor-section">
-      <div class="motor-title">🦾 ARM Motor Control</div>
-      
-      <div class="control-group">
-        <div class="pid-group">
-          <label for="armP">P Gain:</label>
-          <input type="number" id="armP" step="0.1" value="20" min="0" max="100">
-        </div>
-        <div class="pid-group">
-          <label for="armI">I Gain:</label>
-          <input type="number" id="armI" step="0.1" value="15" min="0" max="100">
-        </div>
-        <div class="pid-group">
-          <label for="armD">D Gain:</label>
-          <input type="number" id="armD" step="0.1" value="0" min="0" max="100">
-        </div>
-      </div>
-      
-      <div class="angle-control">
-        <label for="armAngle">Target Angle:</label>
-        <div class="slider-container">
-          <input type="range" id="armAngle" min="-180" max="180" value="0" oninput="updateAngleDisplay('arm', this.value)">
-        </div>
-        <div class="angle-display" id="armAngleDisplay">0°</div>
-        <button class="button" onclick="applyArmSettings()">Apply ARM Settings</button>
-      </div>
-    </div>
-    
-    <!-- WRIST Motor Section -->
-    <div class="motor-section">
-      <div class="motor-title">🤏 WRIST Motor Control</div>
-      
-      <div class="control-group">
-        <div class="pid-group">
-          <label for="wristP">P Gain:</label>
-          <input type="number" id="wristP" step="0.1" value="2" min="0" max="100">
-        </div>
-        <div class="pid-group">
-          <label for="wristI">I Gain:</label>
-          <input type="number" id="wristI" step="0.1" value="0" min="0" max="100">
-        </div>
-        <div class="pid-group">
-          <label for="wristD">D Gain:</label>
-          <input type="number" id="wristD" step="0.1" value="0" min="0" max="100">
-        </div>
-      </div>
-      
-      <div class="angle-control">
-        <label for="wristAngle">Target Angle:</label>
-        <div class="slider-container">
-          <input type="range" id="wristAngle" min="-180" max="180" value="0" oninput="updateAngleDisplay('wrist', this.value)">
-        </div>
-        <div class="angle-display" id="wristAngleDisplay">0°</div>
-        <button class="button" onclick="applyWristSettings()">Apply WRIST Settings</button>
-      </div>
-    </div>
-    
-    <!-- Status Section -->
-    <div class="status">
-      <h3>📊 Current Status</h3>
-      <div class="current-values">
-        <div class="value-display">
-          <h4>ARM Motor</h4>
-          <div style="font-size: 1.5em; color: #00FFFF; font-weight: bold;">Current: <span id="currentArmAngle">--</span>°</div>
-          <div>Target: <span id="targetArmAngle">--</span>°</div>
-          <div style="font-size: 0.8em; color: #888;">Last update: <span id="armLastUpdate">--</span></div>
-        </div>
-        <div class="value-display">
-          <h4>WRIST Motor</h4>
-          <div style="font-size: 1.5em; color: #00FFFF; font-weight: bold;">Current: <span id="currentWristAngle">--</span>°</div>
-          <div>Target: <span id="targetWristAngle">--</span>°</div>
-          <div style="font-size: 0.8em; color: #888;">Last update: <span id="wristLastUpdate">--</span></div>
-        </div>
-      </div>
-      <div style="margin-top: 15px; padding: 10px; background: rgba(255,255,255,0.1); border-radius: 5px;">
-        <div>Connection Status: <span id="connectionStatus" style="color: #00FF00;">Connecting...</span></div>
-        <div>Updates Received: <span id="updateCount">0</span></div>
-        <button onclick="emergencyStop()" style="width: 100%; margin-top: 10px; padding: 10px; background: linear-gradient(45deg, #DC2626, #EF4444); color: white; border: none; border-radius: 5px; font-weight: bold; cursor: pointer;">🚨 EMERGENCY STOP 🚨</button>
-      </div>
-    </div>
-  </div>
-
-  <script>
-    let updateCount = 0;
-    
-    function updateAngleDisplay(motor, value) {
-      document.getElementById(motor + 'AngleDisplay').innerText = value + '°';
-    }
-    
-    function applyArmSettings() {
-      const p = document.getElementById('armP').value;
-      const i = document.getElementById('armI').value;
-      const d = document.getElementById('armD').value;
-      const angle = document.getElementById('armAngle').value;
-      
-      console.log('Sending ARM settings:', {p, i, d, angle});
-      
-      // Disable button during request
-      const button = event.target;
-      button.disabled = true;
-      button.textContent = 'Applying...';
-      
-      // Create abort controller for timeout
-      const controller = new AbortController();
-      const timeoutId = setTimeout(() => controller.abort(), 8000);
-      
-      fetch('/setArmPID', {
-        method: 'POST',
-        headers: {
-          'Content-Type': 'application/x-www-form-urlencoded',
-        },
-        body: `p=${p}&i=${i}&d=${d}&angle=${angle}`,
-        signal: controller.signal
-      })
-      .then(response => {
-        clearTimeout(timeoutId);
-        if (!response.ok) {
-          throw new Error(`HTTP error! status: ${response.status}`);
-        }
-        return response.text();
-      })
-      .then(data => {
-        document.getElementById('targetArmAngle').innerText = angle;
-        console.log('ARM response:', data);
-        
-        // Show success feedback
-        button.style.background = 'linear-gradient(45deg, #10B981, #34D399)';
-        button.textContent = 'Success!';
-        setTimeout(() => {
-          button.style.background = '';
-          button.textContent = 'Apply ARM Settings';
-        }, 2000);
-      })
-      .catch(error => {
-        clearTimeout(timeoutId);
-        console.error('Error:', error);
-        
-        let errorMsg = 'Connection error. ';
-        if (error.name === 'AbortError') {
-          errorMsg = 'Request timeout. ';
-        }
-        errorMsg += 'Check connection and try again.';
-        
-        // Show error feedback
-        button.style.background = 'linear-gradient(45deg, #DC2626, #EF4444)';
-        button.textContent = 'Error!';
-        setTimeout(() => {
-          button.style.background = '';
-          button.textContent = 'Apply ARM Settings';
-        }, 3000);
-        
-        alert(errorMsg);
-      })
-      .finally(() => {
-        // Re-enable button
-        button.disabled = false;
-      });
-    }
-    
-    function applyWristSettings() {
-      const p = document.getElementById('wristP').value;
-      const i = document.getElementById('wristI').value;
-      const d = document.getElementById('wristD').value;
-      const angle = document.getElementById('wristAngle').value;
-      
-      console.log('Sending WRIST settings:', {p, i, d, angle});
-      
-      // Disable button during request
-      const button = event.target;
-      button.disabled = true;
-      button.textContent = 'Applying...';
-      
-      // Create abort controller for timeout
-      const controller = new AbortController();
-      const timeoutId = setTimeout(() => controller.abort(), 8000);
-      
-      fetch('/setWristPID', {
-        method: 'POST',
-        headers: {
-          'Content-Type': 'application/x-www-form-urlencoded',
-        },
-        body: `p=${p}&i=${i}&d=${d}&angle=${angle}`,
-        signal: controller.signal
-      })
-      .then(response => {
-        clearTimeout(timeoutId);
-        if (!response.ok) {
-          throw new Error(`HTTP error! status: ${response.status}`);
-        }
-        return response.text();
-      })
-      .then(data => {
-        document.getElementById('targetWristAngle').innerText = angle;
-        console.log('WRIST response:', data);
-        
-        // Show success feedback
-        button.style.background = 'linear-gradient(45deg, #10B981, #34D399)';
-        button.textContent = 'Success!';
-        setTimeout(() => {
-          button.style.background = '';
-          button.textContent = 'Apply WRIST Settings';
-        }, 2000);
-      })
-      .catch(error => {
-        clearTimeout(timeoutId);
-        console.error('Error:', error);
-        
-        let errorMsg = 'Connection error. ';
-        if (error.name === 'AbortError') {
-          errorMsg = 'Request timeout. ';
-        }
-        errorMsg += 'Check connection and try again.';
-        
-        // Show error feedback
-        button.style.background = 'linear-gradient(45deg, #DC2626, #EF4444)';
-        button.textContent = 'Error!';
-        setTimeout(() => {
-          button.style.background = '';
-          button.textContent = 'Apply WRIST Settings';
-        }, 3000);
-        
-        alert(errorMsg);
-      })
-      .finally(() => {
-        // Re-enable button
-        button.disabled = false;
-      });
-    }
-    
-    // Update current angles every second
-    function updateAngles() {
-      // Create abort controller for timeout
-      const controller = new AbortController();
-      const timeoutId = setTimeout(() => controller.abort(), 3000);
-      
-      fetch('/getAngles', {
-        method: 'GET',
-        signal: controller.signal
-      })
-        .then(response => {
-          clearTimeout(timeoutId);
-          if (!response.ok) {
-            throw new Error(`Network response was not ok: ${response.status}`);
-          }
-          return response.json();
-        })
-        .then(data => {
-          console.log('Received angle data:', data);
-          
-          // Validate data
-          if (typeof data.armAngle === 'number' && typeof data.wristAngle === 'number') {
-            updateCount++;
-            
-            document.getElementById('currentArmAngle').innerText = data.armAngle.toFixed(1);
-            document.getElementById('currentWristAngle').innerText = data.wristAngle.toFixed(1);
-            document.getElementById('armLastUpdate').innerText = new Date().toLocaleTimeString();
-            document.getElementById('wristLastUpdate').innerText = new Date().toLocaleTimeString();
-            document.getElementById('updateCount').innerText = updateCount;
-            
-            // Update connection status
-            document.getElementById('connectionStatus').innerText = 'Connected';
-            document.getElementById('connectionStatus').style.color = '#10B981';
-          } else {
-            throw new Error('Invalid data format received');
-          }
-        })
-        .catch(error => {
-          clearTimeout(timeoutId);
-          console.error('Error fetching angles:', error);
-          
-          if (error.name === 'AbortError') {
-            document.getElementById('connectionStatus').innerText = 'Request Timeout';
-          } else {
-            document.getElementById('connectionStatus').innerText = 'Connection Error';
-          }
-          document.getElementById('connectionStatus').style.color = '#EF4444';
-        });
-    }
-    
-    // Emergency stop function
-    function emergencyStop() {
-      console.log('EMERGENCY STOP ACTIVATED!');
-      
-      fetch('/emergency', {
-        method: 'GET'
-      })
-      .then(response => {
-        if (response.ok) {
-          document.getElementById('connectionStatus').innerText = 'Emergency Stop Active';
-          document.getElementById('connectionStatus').style.color = '#EF4444';
-          alert('Emergency stop activated! Motors stopped.');
-        }
-      })
-      .catch(error => {
-        console.error('Emergency stop error:', error);
-        alert('Emergency stop request failed! Check connection.');
-      });
-    }
-    
-    // Start updating angles immediately and then every second
-    updateAngles();
-    setInterval(updateAngles, 1000);
-    
-    // Test connection on load
-    window.onload = function() {
-      console.log('Page loaded, testing connection...');
-      updateAngles();
-    };
-  </script>
-</body>
-</html>
-)rawliteral";
-
-void scan_4_I2C(){
+int formatLoopStats(char *buf, size_t len, const LoopStats &stats) {
+  return snprintf(buf, len,
+                  "{\"count\":%lu,\"periodUs\":{\"min\":%lu,\"mean\":%.1f,\"max\":%lu},"
+                  "\"jitterUs\":{\"max\":%lu,\"rms\":%.1f},\"execUs\":{\"mean\":%.1f,\"max\":%lu},\"overruns\":%lu}",
+                  (unsigned long)stats.count,
+                  (unsigned long)stats.minPeriodUs, stats.meanPeriodUs(), (unsigned long)stats.maxPeriodUs,
+                  (unsigned long)stats.maxJitterUs, stats.rmsJitterUs(),
+                  stats.meanExecUs(), (unsigned long)stats.maxExecUs, (unsigned long)stats.overruns);
+}
+
+// Every route goes through this, so each handler's run time is recorded. The
+// async_tcp task may switch cores and each core has its own cycle counter, so
+// this times with micros() and scales to cycles.
+ArRequestHandlerFunction timed(ArRequestHandlerFunction handler) {
+  return [handler](AsyncWebServerRequest *request) {
+    unsigned long start = micros();
+    handler(request);
+    webHandlerTime.record((micros() - start) * ESP.getCpuFreqMHz());
+  };
+}
+
+void scan_4_I2C(TwoWire &bus){
   byte error, address;
   int nDevices;
   Serial.println("Scanning...");
   nDevices = 0;
   for(address = 1; address < 127; address++ ) {
-    Wire.beginTransmission(address);
-    error = Wire.endTransmission();
+    bus.beginTransmission(address);
+    error = bus.endTransmission();
     if (error == 0) {
       Serial.print("I2C device found at address 0x");
       if (address<16) {
@@ -632,15 +366,73 @@ void scan_4_I2C(){
 
 void setup() {
  Serial.begin(115200);
- delay(100);
 
- // Create I2C mutex for thread safety
- i2cMutex = xSemaphoreCreateMutex();
- if (i2cMutex == NULL) {
-   Serial.println("Failed to create I2C mutex!");
-   while(1); // halt if mutex creation fails
+ // Tasks and handlers log through the deferred logger
+ logger.begin(arduinoClock);
+ xTaskCreatePinnedToCore(logTask, "log", LOG_TASK_STACK, NULL, LOG_TASK_PRIORITY, NULL, PRO_CPU_NUM);
+
+ // Tuning, calibration and targets in one NVS read
+ bool restored = configStore.load(config);
+
+ for (size_t b = 0; b < sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]); b++) {
+   uint32_t start = ESP.getCycleCount();
+   i2cBuses[b]->begin(I2C_BUSES[b].sda, I2C_BUSES[b].scl, I2C_BUSES[b].clockHz);
+   busInitCycles[b] = ESP.getCycleCount() - start;
+ }
+
+ // Full bus scans take seconds: only when asked for via /diagnostics (next
+ // boot only) or in builds with BOOT_DIAGNOSTICS
+#ifdef BOOT_DIAGNOSTICS
+ bool diagnostics = true;
+#else
+ bool diagnostics = config.bootDiagnostics;
+#endif
+ if (diagnostics) {
+   for (size_t b = 0; b < sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]); b++) {
+     Serial.printf("\nScanning Wire%u | Pins: %d %d\n", (unsigned)b, I2C_BUSES[b].sda, I2C_BUSES[b].scl);
+     scan_4_I2C(*i2cBuses[b]);
+   }
+
+   if (config.bootDiagnostics) {
+     config.bootDiagnostics = false;
+     configStore.save(config);
+   }
  }
 
+ // A lock per bus; every joint but the first also gets a worker on the other core
+ for (int j = 0; j < JOINT_COUNT; j++) {
+   if (!sensorEncoders[j].begin() || (j > 0 && !encoders[j].begin(PRO_CPU_NUM, CONTROL_TASK_PRIORITY))) {
+     Serial.println("Failed to start encoders!");
+     while(1); // halt if the locks or workers cannot be created
+   }
+ }
+
+ for (int j = 0; j < JOINT_COUNT; j++) {
+   AS5600 &sensor = sensors[j];
+   const char *name = JOINTS[j].name;
+   if (!sensor.detectMagnet()) Serial.printf("%s Magnet Not Detected, Check if magnet is too far away or missing\n", name);
+   if (sensor.magnetTooWeak()) Serial.printf("%s Magnet too weak, move it closer\n", name);
+   if (sensor.magnetTooStrong()) Serial.printf("%s Magnet too strong, move it away\n", name);
+   sensorEncoders[j].setOffset(config.offset[j]);
+   sensorEncoders[j].resetCumulative();
+ }
+
+ acquisition.begin();
+ control.begin();
+ applyConfig();
+
+ // Close the loop first; WiFi and the web server come up next to it
+ controlPeriodTicks = rateToTicks(config.controlRateHz);
+ controlStats.reset(controlPeriodTicks * portTICK_PERIOD_MS * 1000);
+ acquisitionStats.reset(controlPeriodTicks * portTICK_PERIOD_MS * 1000);
+ updateTelemetryDecimation();
+ xTaskCreatePinnedToCore(controlTask, "control", CONTROL_TASK_STACK, NULL,
+                         CONTROL_TASK_PRIORITY, &controlTaskHandle, APP_CPU_NUM);
+ xTaskCreatePinnedToCore(acquisitionTask, "acquisition", ACQUISITION_TASK_STACK, NULL,
+                         ACQUISITION_TASK_PRIORITY, &acquisitionTaskHandle, APP_CPU_NUM);
+ Serial.printf("Control loop running at %lu Hz, %lu ms after boot (%s configuration)\n",
+               (unsigned long)(configTICK_RATE_HZ / controlPeriodTicks), millis(), restored ? "stored" : "default");
+
  // Initialize WiFi
  WiFi.mode(WIFI_AP);
  WiFi.softAP(ssid, password);
@@ -656,217 +448,527 @@ void setup() {
  Serial.println(WiFi.softAPIP());
  Serial.println("Connect your device to the WiFi network above and navigate to the URL");
 
- delay(3000);
-
- ARM_WIRE
- Serial.print("\nScanning ArmWire | Pins: ");
- Serial.print(ARM_SENSOR_SDA);
- Serial.print(" ");
- Serial.println(ARM_SENSOR_SCL);
- scan_4_I2C();
- END
-
- delay(1000);
-
- WRIST_WIRE
- Serial.print("\nScanning WristWire | Pins: ");
- Serial.print(WRIST_SENSOR_SDA);
- Serial.print(" ");
- Serial.println(WRIST_SENSOR_SCL);
- scan_4_I2C();
- END
-
- delay(1000);
- 
- WRIST_WIRE
- //TODO: Check if sensor remembers assigned address. It Does not.
- Arm.begin();
- Arm.setDirection(AS5600_COUNTERCLOCK_WISE);  //  default, just be explicit.
- END
-
- ARM_WIRE
- Wrist.begin();
- Wrist.setDirection(AS5600_COUNTERCLOCK_WISE);  //  default, just be explicit.
- END
-  
- ARM_WIRE
- if (!Arm.detectMagnet()) Serial.println("Arm Magnet Not Detected, Check if magnet is too far away or missing");
- if (Arm.magnetTooWeak()) Serial.println("Arm Magnet too weak, move it closer");
- if (Arm.magnetTooStrong()) Serial.println("Arm Magnet too strong, move it away");
-  Arm.setOffset(armOffset);
- END
-
- WRIST_WIRE
- if (!Wrist.detectMagnet()) Serial.println("Wrist Magnet Not Detected, Check if magnet is too far away or missing");
- if (Wrist.magnetTooWeak()) Serial.println("Wrist Magnet too weak, move it closer");
- if (Wrist.magnetTooStrong()) Serial.println("Wrist Magnet too strong, move it away");
-
- Wrist.setOffset(wristOffset);
- Wrist.resetCumulativePosition();
- END
-
- pinMode(Motor0,OUTPUT);
- pinMode(Motor0A1, OUTPUT);
- pinMode(Motor0A2, OUTPUT);
-
- digitalWrite(Motor0A1,HIGH);
- digitalWrite(Motor0A2,LOW);
- 
- pinMode(Motor1,OUTPUT);
- pinMode(Motor1A1, OUTPUT);
- pinMode(Motor1A2, OUTPUT);
-
- digitalWrite(Motor1A1,HIGH);
- digitalWrite(Motor1A2,LOW);
-
- ledcSetup(0,freq,resolution);
- ledcAttachPin(Motor0,0);
- ledcSetup(1,freq,resolution);
- ledcAttachPin(Motor1,1);
-
-  
-  // ARM_WIRE
-  // float armAngle = Arm.readAngle()*ang2deg;
-  // m0.setSetpoint(armAngle);
-  // Wire.end();
-
-  // WRIST_WIRE
-  // float wristAngle = Wrist.readAngle()*ang2deg;
-  // m1.setSetpoint(wristAngle);
-  // Wire.end();
-
-  // delay(10000);
-
   // Setup web server routes
   // Serve the main page
-  server.on("/", HTTP_GET, [](AsyncWebServerRequest *request){
-    Serial.println("Web page requested!");
-    request->send(200, "text/html", index_html);
-  });
+  server.on("/", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    LOG_DEBUG("Web page requested!");
+    // Browsers revalidate on every load (no-cache) and get a 304 while the
+    // firmware's page is unchanged
+    if (request->hasHeader("If-None-Match") &&
+        request->getHeader("If-None-Match")->value() == INDEX_HTML_ETAG) {
+      AsyncWebServerResponse *response = request->beginResponse(304);
+      response->addHeader("ETag", INDEX_HTML_ETAG);
+      request->send(response);
+      return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse_P(200, "text/html", index_html_gz, INDEX_HTML_GZ_LEN);
+    response->addHeader("Content-Encoding", "gzip");
+    response->addHeader("ETag", INDEX_HTML_ETAG);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
 
-  // Handle ARM PID settings
-  server.on("/setArmPID", HTTP_POST, [](AsyncWebServerRequest *request){
-    Serial.println("ARM PID request received");
+  // Position loop gains and target of one joint: joint=<name>|<index>
+  server.on("/setPID", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    LOG_DEBUG("PID request received");
     
-    if (request->hasParam("p", true) && request->hasParam("i", true) && 
+    if (request->hasParam("joint", true) && request->hasParam("p", true) && request->hasParam("i", true) && 
         request->hasParam("d", true) && request->hasParam("angle", true)) {
       
-      float p = request->getParam("p", true)->value().toFloat();
-      float i = request->getParam("i", true)->value().toFloat();
-      float d = request->getParam("d", true)->value().toFloat();
-      float angle = request->getParam("angle", true)->value().toFloat();
-      
-      // Validate ranges
-      p = constrain(p, 0, 1000);
-      i = constrain(i, 0, 1000);
-      d = constrain(d, 0, 1);
-      angle = constrain(angle, -180, 180);
-      
-      // // Add delay to prevent I2C conflicts during PID updates
-      // delay(10);
-      
-      m0.setP(p);
-      m0.setI(i);
-      m0.setD(d);
-      m0.setSetpoint(angle);
-      m0.reset();
+      int j = jointParam(request);
+      if (j < 0) {
+        request->send(400, "text/plain", "Unknown joint");
+        return;
+      }
+      const float *max = JOINTS[j].maxGains;
+      float p = constrain(request->getParam("p", true)->value().toFloat(), 0, max[0]);
+      float i = constrain(request->getParam("i", true)->value().toFloat(), 0, max[1]);
+      float d = constrain(request->getParam("d", true)->value().toFloat(), 0, max[2]);
+      float angle = clampAngle(j, request->getParam("angle", true)->value().toFloat());
       
-      Serial.printf("ARM PID updated: P=%.2f, I=%.2f, D=%.2f, Angle=%.2f\n", p, i, d, angle);
+      storeValues(config.gains[j], p, i, d);
+      applyGains(j, false, config.gains[j]);
+      control.resetLoops(j);
+      setTarget(j, angle);
+      markConfigDirty();
       
-      // Small delay before responding
-      // delay(5);
-      request->send(200, "text/plain", "ARM settings applied successfully");
+      LOG_INFO("%s PID updated: P=%.2f, I=%.2f, D=%.2f, Angle=%.2f", JOINTS[j].name, p, i, d, angle);
+      request->send(200, "text/plain", "PID settings applied successfully");
+    } else {
+      LOG_WARN("PID update failed: Missing parameters");
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  // Tool-tip target in mm (Control/Kinematics.h: x forward, y up from the arm
+  // axis), reached along a straight line at speed mm/s (default 100)
+  server.on("/setCartesian", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("x", true) && request->hasParam("y", true)) {
+      float x = request->getParam("x", true)->value().toFloat();
+      float y = request->getParam("y", true)->value().toFloat();
+      float speed = 100;
+      if (request->hasParam("speed", true)) speed = constrain(request->getParam("speed", true)->value().toFloat(), 1, 1000);
+
+      if (control.moveToCartesian(x, y, speed)) {
+        LOG_INFO("Cartesian move to x=%.1f y=%.1f at %.0f mm/s", x, y, speed);
+        request->send(200, "text/plain", "Cartesian move started");
+      } else {
+        request->send(422, "text/plain", "Target out of reach");
+      }
     } else {
-      Serial.println("ARM PID update failed: Missing parameters");
       request->send(400, "text/plain", "Missing parameters");
     }
+  }));
+
+  // Measured tool-tip position
+  server.on("/cartesian", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    JointState state = acquisition.latest();
+    PlanarArm<>::Point tip = control.kinematics.forward(state.angle[0], state.angle[1]);
+    char json[128];
+    snprintf(json, sizeof(json), "{\"x\":%.1f,\"y\":%.1f,\"reach\":%.1f,\"moving\":%s,\"failures\":%lu}",
+             tip.x, tip.y, control.kinematics.reach(), control.cartesianActive() ? "true" : "false",
+             (unsigned long)control.cartesianFailures());
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
+
+  // Bulk waypoint upload: application/octet-stream body in the format described
+  // at WaypointDecoder (Control/Trajectory.h), decoded chunk by chunk
+  server.on("/trajectory", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    bool ok = request == trajectoryUpload && waypointDecoder.finish();
+    trajectoryUpload = NULL;
+
+    char msg[96];
+    snprintf(msg, sizeof(msg), "accepted %u, dropped %u, refused %u (out of range), queued %lu",
+             waypointDecoder.accepted(), waypointDecoder.dropped(), waypointDecoder.refused(),
+             (unsigned long)control.trajectory.queued());
+    if (!ok) request->send(400, "text/plain", "Malformed trajectory");
+    else if (waypointDecoder.refused()) request->send(422, "text/plain", msg);
+    else request->send(waypointDecoder.dropped() ? 507 : 200, "text/plain", msg);
+  }), NULL, [](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total){
+    if (index == 0) {
+      trajectoryUpload = request;
+      waypointDecoder.begin();
+    }
+    if (request == trajectoryUpload) waypointDecoder.feed(data, len);
   });
 
-  // Handle WRIST PID settings
-  server.on("/setWristPID", HTTP_POST, [](AsyncWebServerRequest *request){
-    Serial.println("WRIST PID request received");
-    
-    if (request->hasParam("p", true) && request->hasParam("i", true) && 
-        request->hasParam("d", true) && request->hasParam("angle", true)) {
-      
-      float p = request->getParam("p", true)->value().toFloat();
-      float i = request->getParam("i", true)->value().toFloat();
-      float d = request->getParam("d", true)->value().toFloat();
-      float angle = request->getParam("angle", true)->value().toFloat();
-      
-      // Validate ranges
-      p = constrain(p, 0, 100);
-      i = constrain(i, 0, 100);
-      d = constrain(d, 0, 100);
-      angle = constrain(angle, -180, 180);
-      
-      // Add delay to prevent I2C conflicts during PID updates
-      // delay(10);
-      
-      m1.setP(p);
-      m1.setI(i);
-      m1.setD(d);
-      m1.setSetpoint(angle);
-      m1.reset();
-      
-      Serial.printf("WRIST PID updated: P=%.2f, I=%.2f, D=%.2f, Angle=%.2f\n", p, i, d, angle);
-      
-      // Small delay before responding
-      // delay(5);
-      request->send(200, "text/plain", "WRIST settings applied successfully");
+  server.on("/trajectory", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    char json[96];
+    snprintf(json, sizeof(json), "{\"playing\":%s,\"queued\":%lu,\"capacity\":%lu,\"underruns\":%lu}",
+             control.trajectory.playing() ? "true" : "false", (unsigned long)control.trajectory.queued(),
+             (unsigned long)TrajectoryPlayer::CAPACITY, (unsigned long)control.trajectory.underruns());
+    request->send(200, "application/json", json);
+  }));
+
+  // Motion profile limits per joint: shape=trap|scurve, v/a/j in deg/s, deg/s^2,
+  // deg/s^3, optional kv = velocity feed-forward in duty per deg/s
+  server.on("/setProfile", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("joint", true) && request->hasParam("v", true) &&
+        request->hasParam("a", true) && request->hasParam("j", true)) {
+
+      int j = jointParam(request);
+      if (j < 0) {
+        request->send(400, "text/plain", "Unknown joint");
+        return;
+      }
+      float v = constrain(request->getParam("v", true)->value().toFloat(), 1, 2000);
+      float a = constrain(request->getParam("a", true)->value().toFloat(), 1, 100000);
+      float jerk = constrain(request->getParam("j", true)->value().toFloat(), 1, 1000000);
+
+      storeValues(config.limits[j], v, a, jerk);
+      if (request->hasParam("shape", true)) {
+        bool trap = request->getParam("shape", true)->value() == "trap";
+        config.shape[j] = trap ? MotionProfile::TRAPEZOIDAL : MotionProfile::SCURVE;
+      }
+      control.setProfile(j, v, a, jerk, (MotionProfile::Shape)config.shape[j]);
+      if (request->hasParam("kv", true)) {
+        float kv = constrain(request->getParam("kv", true)->value().toFloat(), 0, 10);
+        control.velocityFF[j] = config.velocityFF[j] = kv;
+      }
+      markConfigDirty();
+
+      LOG_INFO("%s profile: v=%.0f a=%.0f j=%.0f", JOINTS[j].name, v, a, jerk);
+      request->send(200, "text/plain", "Profile settings applied successfully");
     } else {
-      Serial.println("WRIST PID update failed: Missing parameters");
       request->send(400, "text/plain", "Missing parameters");
     }
-  });
+  }));
+
+  // Cascaded control of one joint: its position loop (set via /setPID)
+  // becomes the outer loop, these gains drive the inner velocity loop. vmax
+  // and divider are shared by all joints.
+  server.on("/setCascade", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("joint", true) && request->hasParam("enable", true) && request->hasParam("p", true) &&
+        request->hasParam("i", true) && request->hasParam("d", true)) {
+
+      int j = jointParam(request);
+      if (j < 0) {
+        request->send(400, "text/plain", "Unknown joint");
+        return;
+      }
+      bool enable = request->getParam("enable", true)->value().toInt() != 0;
+      float p = constrain(request->getParam("p", true)->value().toFloat(), 0, MAX_VELOCITY_GAINS[0]);
+      float i = constrain(request->getParam("i", true)->value().toFloat(), 0, MAX_VELOCITY_GAINS[1]);
+      float d = constrain(request->getParam("d", true)->value().toFloat(), 0, MAX_VELOCITY_GAINS[2]);
+      float vmax = ControlLoop::DEFAULT_MAX_VELOCITY;
+      int divider = ControlLoop::DEFAULT_OUTER_DIVIDER;
+      if (request->hasParam("vmax", true)) vmax = constrain(request->getParam("vmax", true)->value().toFloat(), 1, 2000);
+      if (request->hasParam("divider", true)) divider = constrain(request->getParam("divider", true)->value().toInt(), 1, 100);
+
+      storeValues(config.velocityGains[j], p, i, d);
+      applyGains(j, true, config.velocityGains[j]);
+      control.setCascade(vmax, divider);
+      control.setMode(j, enable ? ControlLoop::CASCADE : ControlLoop::POSITION);
+      config.maxVelocity = vmax;
+      config.outerDivider = divider;
+      config.mode[j] = enable ? ControlLoop::CASCADE : ControlLoop::POSITION;
+      markConfigDirty();
+
+      LOG_INFO("%s cascade %s: P=%.2f, I=%.2f, D=%.2f", JOINTS[j].name, enable ? "on" : "off", p, i, d);
+      LOG_INFO("Cascade vmax=%.0f, divider=%d", vmax, divider);
+      request->send(200, "text/plain", "Cascade settings applied successfully");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  // Motor output shaping of one joint, in duty (255 = full): deadband,
+  // stiction offset, reversal hysteresis, and brake=1 to brake when idle
+  server.on("/setDrive", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("joint", true) && request->hasParam("deadband", true) &&
+        request->hasParam("offset", true) && request->hasParam("hysteresis", true)) {
+
+      int j = jointParam(request);
+      if (j < 0) {
+        request->send(400, "text/plain", "Unknown joint");
+        return;
+      }
+      const float limit = ControlLoop::MAX_DUTY / 2;
+      float deadband = constrain(request->getParam("deadband", true)->value().toFloat(), 0, limit);
+      float offset = constrain(request->getParam("offset", true)->value().toFloat(), 0, limit);
+      float hysteresis = constrain(request->getParam("hysteresis", true)->value().toFloat(), 0, limit);
+      storeValues(config.drive[j], deadband, offset, hysteresis);
+      if (request->hasParam("brake", true)) config.brake[j] = request->getParam("brake", true)->value().toInt() != 0;
+      control.driver[j].setShaping(driveShaping(j));
+      markConfigDirty();
+
+      LOG_INFO("%s drive: deadband=%.1f offset=%.1f hysteresis=%.1f %s", JOINTS[j].name, deadband, offset,
+               hysteresis, config.brake[j] ? "brake" : "coast");
+      request->send(200, "text/plain", "Drive settings applied successfully");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
 
   // Get current angles endpoint
-  server.on("/getAngles", HTTP_GET, [](AsyncWebServerRequest *request){
-    Serial.println("Angles requested via web!");
-    
-    // Use static variables to cache readings and prevent excessive I2C access
-    static float lastArmAngle = 0;
-    static float lastWristAngle = 0;
-    static unsigned long lastReadTime = 0;
+  server.on("/getAngles", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    LOG_DEBUG("Angles requested via web!");
     
-    // Rate limit to prevent overwhelming I2C bus - only read every 200ms
-    if (millis() - lastReadTime > 200) {
-      // Use thread-safe I2C reading functions
-      lastArmAngle = readArmAngleSafe();
-      // delay(10); // Small delay between I2C operations
-      lastWristAngle = readWristAngleSafe();
-      
-      lastReadTime = millis();
-      Serial.println("Sensor readings updated safely via web request");
+    // Latest sample from the acquisition task; never touches I2C. One
+    // "<name>Angle" per joint.
+    JointState state = acquisition.latest();
+    char json[48 + 32 * JOINT_COUNT];
+    int n = snprintf(json, sizeof(json), "{");
+    for (int j = 0; j < JOINT_COUNT; j++) {
+      n += snprintf(json + n, sizeof(json) - n, "\"%sAngle\":%.2f,", JOINTS[j].name, apiAngle(j, state.angle[j]));
     }
-    
-    String json = "{\"armAngle\":" + String(lastArmAngle, 2) + 
-                  ",\"wristAngle\":" + String(lastWristAngle, 2) + 
-                  ",\"safetyActive\":false}";
-    Serial.print("Sending JSON: ");
-    Serial.println(json);
+    snprintf(json + n, sizeof(json) - n, "\"safetyActive\":%s}", safetyActive ? "true" : "false");
     
     // Set proper headers for JSON response
     AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
     response->addHeader("Access-Control-Allow-Origin", "*");
     response->addHeader("Cache-Control", "no-cache");
     request->send(response);
-  });
+  }));
 
   // Emergency stop endpoint (manual stop only)
-  server.on("/emergency", HTTP_GET, [](AsyncWebServerRequest *request){
-    Serial.println("EMERGENCY STOP ACTIVATED!");
+  server.on("/emergency", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    LOG_WARN("EMERGENCY STOP ACTIVATED!");
     
-    // Stop both motors immediately
-    ledcWrite(0, 0);
-    ledcWrite(1, 0);
-    
-    // Reset PID controllers to stop any integration buildup
-    m0.reset();
-    m1.reset();
+    // The control task drops the motion and holds the motors off
+    control.stop();
+    capture.trigger(Capture::EMERGENCY_STOP);
     
     request->send(200, "text/plain", "Emergency stop activated");
+  }));
+
+  // Control loop timing statistics
+  server.on("/loopStats", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    char json[640 + 160 * JOINT_COUNT];
+    int n = snprintf(json, sizeof(json), "{\"rateHz\":%lu,\"control\":",
+                     (unsigned long)(configTICK_RATE_HZ / controlPeriodTicks));
+    n += formatLoopStats(json + n, sizeof(json) - n, controlStats);
+    n += snprintf(json + n, sizeof(json) - n, ",\"acquisition\":");
+    n += formatLoopStats(json + n, sizeof(json) - n, acquisitionStats);
+    // Sensor transactions, per joint
+    n += snprintf(json + n, sizeof(json) - n, ",\"i2c\":{");
+    for (int j = 0; j < JOINT_COUNT; j++) {
+      I2CStats stats = sensorEncoders[j].stats();
+      n += snprintf(json + n, sizeof(json) - n,
+                    "%s\"%s\":{\"reads\":%lu,\"checks\":%lu,\"errors\":%lu,\"us\":{\"last\":%lu,\"mean\":%.1f,\"max\":%lu}}",
+                    j ? "," : "", JOINTS[j].name, (unsigned long)stats.reads, (unsigned long)stats.checks,
+                    (unsigned long)stats.errors, (unsigned long)stats.lastUs, stats.meanUs(), (unsigned long)stats.maxUs);
+    }
+    snprintf(json + n, sizeof(json) - n, "}}");
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
+
+  // The same and per-stage timing histograms in Prometheus text format
+  server.on("/metrics", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    AsyncResponseStream *response = request->beginResponseStream("text/plain; version=0.0.4");
+    const uint64_t hz = arduinoClock.cyclesPerSecond();
+    const LoopStats *loops[] = {&controlStats, &acquisitionStats};
+    const char *loopNames[] = {"control", "acquisition"};
+
+    writeMetricHeader(*response, "robotarm_loop_rate_hz", "gauge", "Achieved loop rate");
+    for (int l = 0; l < 2; l++) {
+      float period = loops[l]->meanPeriodUs();
+      response->printf("robotarm_loop_rate_hz{loop=\"%s\"} %.1f\n", loopNames[l], period > 0 ? 1e6f / period : 0);
+    }
+    writeMetricHeader(*response, "robotarm_loop_overruns_total", "counter", "Loop executions longer than the period");
+    for (int l = 0; l < 2; l++) {
+      response->printf("robotarm_loop_overruns_total{loop=\"%s\"} %lu\n", loopNames[l], (unsigned long)loops[l]->overruns);
+    }
+
+    writeStageHeader(*response);
+    writeControlStages(*response, acquisition, control, hz);
+    for (int j = 0; j < JOINT_COUNT; j++) {
+      writeStage(*response, "lock_wait", JOINTS[j].name, sensorEncoders[j].lockTime(), hz);
+      writeStage(*response, "transaction", JOINTS[j].name, sensorEncoders[j].transactionTime(), hz);
+    }
+    writeStage(*response, "web", NULL, webHandlerTime, hz);
+
+    writeMetricHeader(*response, "robotarm_i2c_errors_total", "counter", "Failed sensor transactions");
+    for (int j = 0; j < JOINT_COUNT; j++) {
+      response->printf("robotarm_i2c_errors_total{joint=\"%s\"} %lu\n", JOINTS[j].name,
+                       (unsigned long)sensorEncoders[j].stats().errors);
+    }
+    writeMetricHeader(*response, "robotarm_i2c_bus_init_seconds", "gauge", "Wire.begin() duration at boot");
+    for (size_t b = 0; b < sizeof(I2C_BUSES) / sizeof(I2C_BUSES[0]); b++) {
+      response->printf("robotarm_i2c_bus_init_seconds{bus=\"%u\"} %.6f\n", (unsigned)b, (double)busInitCycles[b] / hz);
+    }
+
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
+
+  // Arm the capture: triggers = mask of Capture::Trigger (1 setpoint change,
+  // 2 tracking error, 4 emergency stop), pre = ticks kept before the trigger,
+  // error = tracking error threshold in deg. trigger=1 fires it by hand.
+  server.on("/capture", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("trigger", true)) {
+      capture.trigger(Capture::MANUAL);
+      request->send(200, "text/plain", "Capture triggered");
+    } else if (request->hasParam("triggers", true) && request->hasParam("pre", true)) {
+      uint8_t triggers = constrain(request->getParam("triggers", true)->value().toInt(), 0, 15);
+      uint32_t pre = constrain(request->getParam("pre", true)->value().toInt(), 0, Capture::CAPACITY - 1);
+      float error = 10.0f;
+      if (request->hasParam("error", true)) error = constrain(request->getParam("error", true)->value().toFloat(), 0, 360);
+      capture.arm(triggers, pre, error);
+      LOG_INFO("Capture armed: triggers=%u pre=%lu error=%.1f", triggers, (unsigned long)pre, error);
+      request->send(200, "text/plain", "Capture armed");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  server.on("/capture", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    static const char *states[] = { "idle", "armed", "triggered", "done" };
+    char json[128];
+    snprintf(json, sizeof(json), "{\"state\":\"%s\",\"cause\":%u,\"count\":%lu,\"capacity\":%lu}",
+             states[capture.state()], capture.cause(), (unsigned long)capture.count(),
+             (unsigned long)Capture::CAPACITY);
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
+
+  // Binary capture in the format described at Capture (Control/Capture.h)
+  server.on("/captureData", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    if (capture.state() != Capture::DONE) {
+      request->send(409, "text/plain", "No finished capture");
+      return;
+    }
+    AsyncWebServerResponse *response = request->beginResponse("application/octet-stream", capture.size(),
+        [](uint8_t *buffer, size_t maxLen, size_t index) -> size_t {
+          return capture.read(buffer, maxLen, index);
+        });
+    response->addHeader("Content-Disposition", "attachment; filename=capture.bin");
+    request->send(response);
+  }));
+
+  // Relay autotune: joint=<name>|<index>, rule=zn|tl|none|pi (Ziegler-Nichols,
+  // Tyreus-Luyben, no overshoot, Ziegler-Nichols PI), optional relay (duty)
+  // and step (deg) for the verification run. apply=1 takes over the gains
+  // of a finished run, abort=1 stops a running one.
+  server.on("/autotune", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("abort", true)) {
+      control.autotune.abort();
+      request->send(200, "text/plain", "Autotune aborted");
+    } else if (request->hasParam("apply", true)) {
+      if (control.autotune.state() != Autotuner::DONE) {
+        request->send(409, "text/plain", "No finished autotune");
+        return;
+      }
+      const Autotuner::Result &r = control.autotune.result();
+      int j = control.autotune.joint();
+      // Same limits as /setPID: a noisy relay run must not store wild gains
+      const float *max = JOINTS[j].maxGains;
+      float p = constrain(r.kp, 0, max[0]);
+      float i = constrain(r.ki, 0, max[1]);
+      float d = constrain(r.kd, 0, max[2]);
+      bool limited = p != r.kp || i != r.ki || d != r.kd;
+      storeValues(config.gains[j], p, i, d);
+      applyGains(j, false, config.gains[j]);
+      markConfigDirty();
+      LOG_INFO("%s autotuned gains applied: P=%.2f, I=%.2f, D=%.3f%s", JOINTS[j].name, p, i, d,
+               limited ? " (limited)" : "");
+      request->send(200, "text/plain", limited ? "Autotuned gains applied, limited to the joint's maximum gains"
+                                               : "Autotuned gains applied");
+    } else if (request->hasParam("joint", true)) {
+      Autotuner::Settings settings;
+      if (request->hasParam("rule", true)) {
+        String rule = request->getParam("rule", true)->value();
+        if (rule == "zn") settings.rule = Autotuner::ZIEGLER_NICHOLS;
+        else if (rule == "tl") settings.rule = Autotuner::TYREUS_LUYBEN;
+        else if (rule == "none") settings.rule = Autotuner::NO_OVERSHOOT;
+        else if (rule == "pi") settings.rule = Autotuner::ZIEGLER_NICHOLS_PI;
+        else {
+          request->send(400, "text/plain", "Unknown rule");
+          return;
+        }
+      }
+      if (request->hasParam("relay", true)) settings.relay = constrain(request->getParam("relay", true)->value().toFloat(), 10, 200);
+      if (request->hasParam("step", true)) settings.step = constrain(request->getParam("step", true)->value().toFloat(), -30, 30);
+
+      int joint = jointParam(request);
+      if (joint < 0) {
+        request->send(400, "text/plain", "Unknown joint");
+      } else if (control.startAutotune(joint, settings)) {
+        LOG_INFO("Autotune started on %s, rule %u", JOINTS[joint].name, settings.rule);
+        request->send(200, "text/plain", "Autotune started");
+      } else {
+        request->send(409, "text/plain", "Autotune busy or joint in cascade mode");
+      }
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  server.on("/autotune", HTTP_GET, timed([](AsyncWebServerRequest *request){
+    static const char *states[] = { "idle", "relay", "verify", "done", "failed" };
+    const Autotuner::Result &r = control.autotune.result();
+    char json[320];
+    snprintf(json, sizeof(json),
+             "{\"state\":\"%s\",\"joint\":%d,\"failure\":\"%s\",\"ku\":%.3f,\"tu\":%.4f,"
+             "\"p\":%.3f,\"i\":%.3f,\"d\":%.4f,\"overshoot\":%.1f,\"settlingTime\":%.3f,\"settled\":%s}",
+             states[control.autotune.state()], control.autotune.joint(), control.autotune.failure(),
+             r.ku, r.tu, r.kp, r.ki, r.kd, r.overshoot, r.settlingTime, r.settled ? "true" : "false");
+    AsyncWebServerResponse *response = request->beginResponse(200, "application/json", json);
+    response->addHeader("Cache-Control", "no-cache");
+    request->send(response);
+  }));
+
+  // Sensor calibration: AS5600 offsets in deg, one parameter per joint name
+  // (any subset), stored with the configuration
+  server.on("/setOffsets", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    bool any = false;
+    for (int j = 0; j < JOINT_COUNT; j++) {
+      if (!request->hasParam(JOINTS[j].name, true)) continue;
+      config.offset[j] = constrain(request->getParam(JOINTS[j].name, true)->value().toFloat(), -360, 360);
+      sensorEncoders[j].setOffset(config.offset[j]);
+      LOG_INFO("%s offset: %.2f", JOINTS[j].name, config.offset[j]);
+      any = true;
+    }
+    if (any) {
+      markConfigDirty();
+      request->send(200, "text/plain", "Offsets applied successfully");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  // Run the I2C bus scans on the next boot
+  server.on("/diagnostics", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    config.bootDiagnostics = true;
+    markConfigDirty();
+    request->send(200, "text/plain", "Bus scans will run on the next boot");
+  }));
+
+  // Change the control rate (Hz) at runtime
+  server.on("/setControlRate", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("hz", true)) {
+      controlPeriodTicks = rateToTicks(request->getParam("hz", true)->value().toInt());
+      config.controlRateHz = configTICK_RATE_HZ / controlPeriodTicks;
+      markConfigDirty();
+      controlStatsReset = true;
+      acquisitionStatsReset = true;
+      for (AS5600Encoder &encoder : sensorEncoders) encoder.resetStats();
+      updateTelemetryDecimation();
+      LOG_INFO("Control rate set to %lu Hz", (unsigned long)(configTICK_RATE_HZ / controlPeriodTicks));
+      request->send(200, "text/plain", "Control rate updated");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  // Telemetry rate (Hz) for /ws clients, 0 = off; capped at the control rate
+  server.on("/setTelemetryRate", HTTP_POST, timed([](AsyncWebServerRequest *request){
+    if (request->hasParam("hz", true)) {
+      telemetryHz = constrain(request->getParam("hz", true)->value().toInt(), 0, configTICK_RATE_HZ);
+      updateTelemetryDecimation();
+      LOG_INFO("Telemetry every %lu control steps", (unsigned long)telemetry.decimation());
+      request->send(200, "text/plain", "Telemetry rate updated");
+    } else {
+      request->send(400, "text/plain", "Missing parameters");
+    }
+  }));
+
+  // /ws carries telemetry out and binary commands (Control/Commands.h) in;
+  // each command is acked to its sender
+  ws.onEvent([](AsyncWebSocket *server, AsyncWebSocketClient *client, AwsEventType type,
+                void *arg, uint8_t *data, size_t len){
+    if (type == WS_EVT_CONNECT) {
+      LOG_INFO("WebSocket client #%u connected", client->id());
+    } else if (type == WS_EVT_DISCONNECT) {
+      LOG_INFO("WebSocket client #%u disconnected", client->id());
+    } else if (type == WS_EVT_DATA) {
+      // Commands are a few bytes: only whole, unfragmented binary messages
+      AwsFrameInfo *info = (AwsFrameInfo *)arg;
+      if (info->opcode != WS_BINARY || !info->final || info->index != 0 || info->len != len) return;
+
+      Command cmd;
+      CommandProtocol::Status status = CommandProtocol::decode(data, len, cmd);
+      if (status == CommandProtocol::OK) status = handleCommand(cmd);
+      else LOG_WARN("Rejected command type %u seq %u: status %u", cmd.type, cmd.seq, status);
+      uint8_t ack[CommandProtocol::ACK_SIZE];
+      client->binary(ack, CommandProtocol::encodeAck(ack, cmd, status));
+    }
   });
+  server.addHandler(&ws);
+
+  // Teleop packets become the setpoints directly, without profile planning;
+  // every packet is acked so the sender can time the round trip
+  if (teleopUdp.listen(TELEOP_PORT)) {
+    teleopUdp.onPacket([](AsyncUDPPacket &packet){
+      float angles[JOINT_COUNT];
+      TeleopReceiver::Status status = teleop.receive(packet.data(), packet.length(), angles);
+      if (status == TeleopReceiver::ACCEPTED) {
+        for (int j = 0; j < JOINT_COUNT; j++) control.track(j, clampAngle(j, angles[j]));
+        lastCommandTime = millis();
+        teleopActive = true;
+        safetyActive = false;
+      }
+      uint8_t ack[TeleopReceiver::ACK_SIZE];
+      packet.write(ack, teleop.encodeAck(ack, packet.data(), packet.length(), status));
+    });
+  } else {
+    Serial.println("Failed to open teleop UDP port");
+  }
 
   // Start server
   server.begin();
@@ -874,66 +976,34 @@ void setup() {
   Serial.print("Open http://");
   Serial.print(WiFi.softAPIP());
   Serial.println(" in your browser");
-
 }
 
 void loop() {
-  CT=micros();
-  DT=CT-PT;
-  PT=CT;
-
-  // Safety timeout disabled - continuous operation mode
-  // Note: Safety timeout system has been disabled per user request
-  // Motors will run continuously based on PID setpoints
-
-  // Add a small delay to prevent overwhelming the I2C bus
-  static unsigned long lastSensorRead = 0;
-  if (millis() - lastSensorRead < 20) {  // Limit sensor reads to 50Hz max
-    // delay(1);
-    return;
+  // Control runs in controlTask; this ships its telemetry in batches and
+  // watches the teleop deadman. Frames are dropped rather than queued when a
+  // client falls behind.
+  vTaskDelay(pdMS_TO_TICKS(TELEMETRY_FRAME_MS));
+  size_t len;
+  while ((len = telemetry.packFrame(telemetryFrame, sizeof(telemetryFrame))) > 0) {
+    if (ws.count() > 0 && ws.availableForWriteAll()) ws.binaryAll(telemetryFrame, len);
   }
-  lastSensorRead = millis();
-
-  // Use thread-safe I2C reading functions
-  float armAngle = readArmAngleSafe();
-  // Serial.print("Arm Angle : ");
-  // Serial.println(armAngle,2);
-
-  // delay(5);
-
-  float wristAngle = readWristAngleSafe();
-  Serial.print("Wrist Angle : ");
-  // Serial.println(wristAngle,2);
-
-  // Apply motor control without safety checks
-  // Normal operation - compute PID and control motors
-  float m0_corr = m0.compute(armAngle);
-  m0_corr = constrain(m0_corr,-255, 255);
-  if (m0_corr > 0){
-    digitalWrite(Motor0A1,LOW);
-    digitalWrite(Motor0A2,HIGH);
-    //ClockWise
-  }
-  else {
-    digitalWrite(Motor0A1,HIGH);
-    digitalWrite(Motor0A2,LOW);
-    //Counter Clock Wise
+  ws.cleanupClients();
+
+  // Persist configuration changes once they have settled; NVS writes are slow
+  // and wear the flash, so bursts of tuning are saved once
+  if (configDirty && millis() - configChangedAt > CONFIG_SAVE_DELAY_MS) {
+    configDirty = false;
+    if (configStore.save(config)) LOG_INFO("Configuration saved");
+    else LOG_ERROR("Failed to save configuration");
   }
-  ledcWrite(0,(int)abs(m0_corr));
-
-  float m1_corr = m1.compute(wristAngle);
-  m1_corr = constrain(m1_corr,-255, 255);
-  if (m1_corr > 0){
-    digitalWrite(Motor1A1,LOW);
-    digitalWrite(Motor1A2,HIGH);
-    //Counter Clock Wise
-  }
-  else {
-    digitalWrite(Motor1A1,HIGH);
-    digitalWrite(Motor1A2,LOW);
-    //ClockWise
+
+  // Teleop deadman: stream gone, hold every joint where it is
+  if (teleopActive && millis() - lastCommandTime > COMMAND_TIMEOUT) {
+    teleopActive = false;
+    safetyActive = true;
+    JointState state = acquisition.latest();
+    for (int j = 0; j < JOINT_COUNT; j++) control.moveTo(j, apiAngle(j, state.angle[j]));
+    teleop.restart();
+    LOG_WARN("Teleop stream lost, holding position");
   }
-  ledcWrite(1,(int)abs(m1_corr));
-  
-  delay(10); // Small delay to prevent system overload
 }
\ No newline at end of file
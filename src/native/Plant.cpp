@@ -0,0 +1,69 @@
+#include "Plant.h"
+
+#include <math.h>
+
+PlantParams PlantParams::arm() {
+    // Reads 0 deg after the pipeline's -180 shift
+    PlantParams p;
+    p.encoderOffset = 180.0;
+    return p;
+}
+
+PlantParams PlantParams::wrist() {
+    PlantParams p;
+    p.gearRatio = 50.0;
+    p.loadInertia = 0.002;
+    p.gravityTorque = 0.05;
+    p.coulombFriction = 0.02;
+    p.staticFriction = 0.03;
+    p.viscousFriction = 0.002;
+    p.encoderRatio = 4.5;
+    return p;
+}
+
+DCMotorJoint::DCMotorJoint(const PlantParams &params, double startDeg):
+    m_p(params), m_pos(startDeg * M_PI / 180.0), m_vel(0) {
+    m_inertia = m_p.loadInertia + m_p.rotorInertia * m_p.gearRatio * m_p.gearRatio;
+    encoder.setShaft(m_p.encoderOffset + m_p.encoderRatio * startDeg);
+}
+
+double DCMotorJoint::jointDeg() const {
+    return m_pos * 180.0 / M_PI;
+}
+
+double DCMotorJoint::jointVelocity() const {
+    return m_vel * 180.0 / M_PI;
+}
+
+void DCMotorJoint::advance(unsigned long us) {
+    while (us > 0) {
+        unsigned long step = us < SUBSTEP_US ? us : SUBSTEP_US;
+        integrate(step / 1e6);
+        us -= step;
+    }
+    encoder.setShaft(m_p.encoderOffset + m_p.encoderRatio * jointDeg());
+}
+
+void DCMotorJoint::integrate(double dt) {
+    double volts = motor.output() * m_p.supplyVolts;
+
+    // Coasting opens the circuit; braking shorts it (0 V, back-EMF current)
+    double current = motor.state() == Motor::COAST ? 0.0
+                   : (volts - m_p.torqueConstant * m_p.gearRatio * m_vel) / m_p.resistance;
+    double drive = m_p.torqueConstant * current * m_p.gearRatio * m_p.gearEfficiency;
+    double gravity = -m_p.gravityTorque * cos(m_pos);
+    double applied = drive + gravity;
+
+    if (m_vel == 0.0) {
+        // Stuck until the applied torque breaks away
+        if (fabs(applied) <= m_p.staticFriction) return;
+        m_vel = (applied - copysign(m_p.coulombFriction, applied)) / m_inertia * dt;
+    } else {
+        double friction = copysign(m_p.coulombFriction, m_vel) + m_p.viscousFriction * m_vel;
+        double vel = m_vel + (applied - friction) / m_inertia * dt;
+        // Friction alone can stop the joint but never reverse it
+        if ((vel > 0) != (m_vel > 0) && fabs(applied) <= m_p.staticFriction) vel = 0.0;
+        m_vel = vel;
+    }
+    m_pos += m_vel * dt;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "SimHAL.h"
+
+// Physical model of one joint, for closed-loop tuning on the host: a brushed
+// DC motor fed from the H-bridge (PWM averaged over the period, open circuit
+// when coasting), driving the joint through a gearbox, with gravity on the
+// link, Coulomb + viscous friction, stiction, and the AS5600 either on the
+// joint (arm) or geared up from it (wrist, 4.5 encoder turns per joint turn).
+//
+// Motor inductance is ignored (electrical time constant << one tick), so the
+// current follows the back-EMF directly: i = (V - Ke * w_motor) / R.
+struct PlantParams
+{
+    double supplyVolts = 12.0;
+    double resistance = 2.5;        // ohm, armature
+    double torqueConstant = 0.02;   // N*m/A, equal to the back-EMF constant in V*s/rad
+    double rotorInertia = 5e-6;     // kg*m^2, motor side
+    double gearRatio = 100.0;       // motor turns per joint turn
+    double gearEfficiency = 0.8;
+
+    double loadInertia = 0.02;      // kg*m^2, joint side
+    double gravityTorque = 0.5;     // N*m with the link horizontal (joint angle 0)
+    double coulombFriction = 0.05;  // N*m, joint side
+    double staticFriction = 0.08;   // N*m, breakaway
+    double viscousFriction = 0.01;  // N*m*s/rad, joint side
+
+    double encoderRatio = 1.0;      // encoder turns per joint turn
+    double encoderOffset = 0.0;     // deg, encoder shaft angle at joint angle 0
+
+    static PlantParams arm();
+    static PlantParams wrist();
+};
+
+// Drop-in for SimJoint: the control code sees the same SimMotor/SimEncoder.
+class DCMotorJoint
+{
+public:
+    static constexpr unsigned long SUBSTEP_US = 100;
+
+    DCMotorJoint(const PlantParams &params, double startDeg);
+
+    // Integrates over us in substeps of at most SUBSTEP_US.
+    void advance(unsigned long us);
+
+    double jointDeg() const;
+    double jointVelocity() const; // deg/s
+
+    SimMotor motor;
+    SimEncoder encoder;
+
+private:
+    PlantParams m_p;
+    double m_inertia; // reflected to the joint
+    double m_pos;     // rad
+    double m_vel;     // rad/s
+
+    void integrate(double dt);
+};
@@ -0,0 +1,63 @@
+#include "SimHAL.h"
+
+#include <math.h>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+static const double COUNTS_PER_DEG = 4096.0 / 360.0;
+
+#if defined(__x86_64__) || defined(__i386__)
+uint32_t SimClock::cycles() {
+    return (uint32_t)__rdtsc();
+}
+
+// TSC rate, measured once against the steady clock over 20 ms
+uint64_t SimClock::cyclesPerSecond() {
+    static const uint64_t rate = [] {
+        auto start = std::chrono::steady_clock::now();
+        unsigned long long tsc = __rdtsc();
+        while (std::chrono::steady_clock::now() - start < std::chrono::milliseconds(20)) {}
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        return (uint64_t)((__rdtsc() - tsc) / seconds);
+    }();
+    return rate;
+}
+#else
+uint32_t SimClock::cycles() {
+    return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t SimClock::cyclesPerSecond() {
+    return 1000000000ull;
+}
+#endif
+
+bool SimEncoder::readAngle(uint16_t &raw) {
+    if (!m_magnet) return false;
+    double wrapped = fmod(m_shaftDeg, 360.0);
+    if (wrapped < 0) wrapped += 360.0;
+    raw = (uint16_t)((int)floor(wrapped * COUNTS_PER_DEG) & 0x0FFF);
+    return true;
+}
+
+bool SimEncoder::readCumulative(int32_t &counts) {
+    if (!m_magnet) return false;
+    counts = (int32_t)floor(m_shaftDeg * COUNTS_PER_DEG);
+    return true;
+}
+
+SimJoint::SimJoint(double maxSpeedDegPerSec, double timeConstant, double startDeg):
+    m_maxSpeed(maxSpeedDegPerSec), m_tau(timeConstant), m_pos(startDeg), m_vel(0) {
+    encoder.setShaft(startDeg);
+}
+
+void SimJoint::advance(unsigned long us) {
+    double dt = us / 1e6;
+    double target = motor.output() * m_maxSpeed;
+    m_vel += (target - m_vel) * dt / (m_tau + dt);
+    m_pos += m_vel * dt;
+    encoder.setShaft(m_pos);
+}
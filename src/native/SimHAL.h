@@ -0,0 +1,92 @@
+#pragma once
+
+#include "HAL/HAL.h"
+#include "Control/Joints.h"
+
+// Simulated devices for the native build. Time only moves when advance() is
+// called, so a run is deterministic and independent of host load. Only the
+// cycle counter runs on host time (the TSC on x86, else the steady clock in
+// ns), so stage timings are real.
+
+class SimClock : public Clock
+{
+public:
+    SimClock() : m_us(0) {}
+
+    void advance(unsigned long us) { m_us += us; }
+
+    unsigned long micros() override { return m_us; }
+    unsigned long millis() override { return m_us / 1000; }
+
+    uint32_t cycles() override;
+    uint64_t cyclesPerSecond() override;
+
+private:
+    unsigned long m_us;
+};
+
+// H-bridge output: latches the last state and the level as the LEDC would
+// set it, rounded to a whole count at the PWM resolution.
+class SimMotor : public Motor
+{
+public:
+    explicit SimMotor(int bits = PWM_RESOLUTION_BITS) : m_state(COAST), m_level(0) { setResolution(bits); }
+
+    void setResolution(int bits) { m_maxCount = (float)((1u << bits) - 1); }
+
+    void begin() override { drive(COAST, 0); }
+    void drive(Drive state, float level) override
+    {
+        if (level < 0) level = 0;
+        if (level > 1) level = 1;
+        m_state = state;
+        m_level = (uint32_t)(level * m_maxCount + 0.5f) / m_maxCount;
+    }
+
+    Drive state() const { return m_state; }
+    // Signed fraction of the supply across the motor; 0 when braking or coasting
+    double output() const { return m_state == FORWARD ? m_level : m_state == REVERSE ? -m_level : 0.0; }
+
+private:
+    Drive m_state;
+    float m_level;
+    float m_maxCount;
+};
+
+// AS5600 looking at a shaft, quantised to 12 bits.
+class SimEncoder : public Encoder
+{
+public:
+    SimEncoder() : m_shaftDeg(0), m_magnet(true) {}
+
+    bool readAngle(uint16_t &raw) override;
+    bool readCumulative(int32_t &counts) override;
+
+    void setShaft(double deg) { m_shaftDeg = deg; }
+    void setMagnet(bool present) { m_magnet = present; }
+
+private:
+    double m_shaftDeg;
+    bool m_magnet;
+};
+
+// Motor + encoder shaft with a first-order speed response to duty. Positive
+// duty turns the shaft towards increasing encoder counts.
+class SimJoint
+{
+public:
+    SimJoint(double maxSpeedDegPerSec, double timeConstant, double startDeg);
+
+    void advance(unsigned long us);
+
+    double shaftDeg() const { return m_pos; }
+
+    SimMotor motor;
+    SimEncoder encoder;
+
+private:
+    double m_maxSpeed;
+    double m_tau;
+    double m_pos;
+    double m_vel;
+};
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <math.h>
+
+// Step-response figures of merit, fed one sample at a time:
+//   rise time     10% -> 90% of the step
+//   overshoot     peak past the target, % of the step
+//   settling time last time the response was outside +-band of the step
+//   steady-state  |target - response| at the last sample
+//   ITAE          integral of t * |error| dt, deg*s^2
+class StepMetrics
+{
+public:
+    StepMetrics(double start, double target, double band = 0.02):
+        m_start(start), m_target(target), m_band(band),
+        m_t10(-1), m_t90(-1), m_peak(0), m_settling(0), m_itae(0),
+        m_lastT(0), m_lastErr(fabs(target - start)), m_lastY(start) {}
+
+    // t in seconds since the step, y in deg
+    void add(double t, double y) {
+        double step = m_target - m_start;
+        double progress = (y - m_start) / step;
+        if (m_t10 < 0 && progress >= 0.1) m_t10 = t;
+        if (m_t90 < 0 && progress >= 0.9) m_t90 = t;
+        if (progress - 1.0 > m_peak) m_peak = progress - 1.0;
+        if (fabs(progress - 1.0) > m_band) m_settling = t;
+
+        double err = fabs(m_target - y);
+        m_itae += 0.5 * (m_lastT * m_lastErr + t * err) * (t - m_lastT);
+        m_lastT = t;
+        m_lastErr = err;
+        m_lastY = y;
+    }
+
+    double riseTime() const { return m_t10 >= 0 && m_t90 >= 0 ? m_t90 - m_t10 : -1; }
+    double overshoot() const { return m_peak * 100.0; }
+    // -1 if still outside the band at the last sample
+    double settlingTime() const { return m_settling < m_lastT ? m_settling : -1; }
+    double steadyStateError() const { return fabs(m_target - m_lastY); }
+    double itae() const { return m_itae; }
+
+private:
+    double m_start;
+    double m_target;
+    double m_band;
+    double m_t10;
+    double m_t90;
+    double m_peak;
+    double m_settling;
+    double m_itae;
+    double m_lastT;
+    double m_lastErr;
+    double m_lastY;
+};
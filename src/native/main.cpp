@@ -0,0 +1,212 @@
+// Native build of the control path against simulated sensors and H-bridges.
+// Runs the loop for a fixed number of ticks and reports per-step latency and
+// throughput, so control changes can be measured without flashing a board.
+//
+//   pio run -e native && .pio/build/native/program [ticks] [period_us] [position|cascade|autotune] [metrics]
+//
+// autotune runs the relay autotuner on the arm instead of the moves and
+// prints what it identified. metrics then prints the per-stage histograms
+// in the board's /metrics format (TSC cycles instead of CPU cycles).
+//
+// In teleop mode it instead runs the loop in real time at 1 kHz behind the
+// same UDP teleop listener as the board, for scripts/teleop_sender.py:
+//
+//   .pio/build/native/program teleop [port] [seconds]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "Control/Capture.h"
+#include "Control/ControlLoop.h"
+#include "Control/ControlMetrics.h"
+#include "Control/Teleop.h"
+#include "SimHAL.h"
+
+// Same deadman as the board's COMMAND_TIMEOUT
+static const unsigned long COMMAND_TIMEOUT = 2000; // ms
+
+static int serveTeleop(int port, long seconds, SimClock &clock, SimJoint &arm, SimJoint &wrist,
+                       Acquisition &acquisition, ControlLoop &control) {
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    if (sock < 0 || bind(sock, (sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror("teleop socket");
+        return 1;
+    }
+    printf("teleop:       listening on 127.0.0.1:%d for %ld s\n", port, seconds);
+    fflush(stdout);
+
+    const unsigned long period = 1000;
+    TeleopReceiver teleop;
+    bool teleopActive = false;
+    unsigned long lastCommandTime = 0;
+    long deadmanTrips = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    auto next = start;
+    for (long i = 0; i < seconds * 1000000 / (long)period; i++) {
+        next += std::chrono::microseconds(period);
+        std::this_thread::sleep_until(next);
+        clock.advance(period);
+        arm.advance(period);
+        wrist.advance(period);
+
+        uint8_t packet[64];
+        sockaddr_in from;
+        socklen_t fromLen = sizeof(from);
+        ssize_t len;
+        while ((len = recvfrom(sock, packet, sizeof(packet), MSG_DONTWAIT, (sockaddr *)&from, &fromLen)) >= 0) {
+            float angles[JOINT_COUNT];
+            TeleopReceiver::Status status = teleop.receive(packet, len, angles);
+            if (status == TeleopReceiver::ACCEPTED) {
+                for (int j = 0; j < JOINT_COUNT; j++)
+                    control.track(j, std::min(std::max(angles[j], JOINTS[j].minAngle), JOINTS[j].maxAngle));
+                lastCommandTime = clock.millis();
+                teleopActive = true;
+            }
+            uint8_t ack[TeleopReceiver::ACK_SIZE];
+            sendto(sock, ack, teleop.encodeAck(ack, packet, len, status), 0, (sockaddr *)&from, fromLen);
+            fromLen = sizeof(from);
+        }
+
+        acquisition.sample();
+        control.step();
+
+        if (teleopActive && clock.millis() - lastCommandTime > COMMAND_TIMEOUT) {
+            teleopActive = false;
+            for (int j = 0; j < JOINT_COUNT; j++) control.moveTo(j, control.angle(j));
+            teleop.restart();
+            deadmanTrips++;
+        }
+    }
+    close(sock);
+
+    printf("teleop:       accepted %lu, stale %lu, malformed %lu, deadman %ld\n",
+           (unsigned long)teleop.accepted(), (unsigned long)teleop.stale(),
+           (unsigned long)teleop.malformed(), deadmanTrips);
+    printf("final:        arm %.2f deg, wrist %.2f deg\n", control.angle(0), control.angle(1));
+    return 0;
+}
+
+// printf() sink for the Prometheus writers
+struct StdoutMetrics
+{
+    template <typename... Args>
+    void printf(const char *format, Args... args) { ::printf(format, args...); }
+};
+
+int main(int argc, char **argv) {
+    bool teleopMode = argc > 1 && strcmp(argv[1], "teleop") == 0;
+    long ticks = argc > 1 && !teleopMode ? atol(argv[1]) : 100000;
+    unsigned long period = argc > 2 && !teleopMode ? strtoul(argv[2], NULL, 10) : 1000;
+    bool cascade = argc > 3 && strcmp(argv[3], "cascade") == 0;
+    bool autotune = argc > 3 && strcmp(argv[3], "autotune") == 0;
+    bool metrics = argc > 4 && strcmp(argv[4], "metrics") == 0;
+
+    SimClock clock;
+    // Arm encoder reads 2048 counts (0 deg after the -180 shift) at rest;
+    // the wrist encoder turns 4.5 times per joint turn.
+    SimJoint arm(360.0, 0.05, 180.0);
+    SimJoint wrist(360.0 * JOINTS[1].gearRatio, 0.05, 0.0);
+    Encoder *const encoders[JOINT_COUNT] = {&arm.encoder, &wrist.encoder};
+    Motor *const motors[JOINT_COUNT] = {&arm.motor, &wrist.motor};
+
+    Acquisition acquisition(encoders, clock);
+    ControlLoop control(acquisition, motors, clock);
+    acquisition.begin();
+    control.begin();
+    // Armed before the first step so it catches the start of the moves below;
+    // on the board it records only once /capture has armed it
+    static Capture capture;
+    capture.arm(Capture::SETPOINT_CHANGE, 64, 10.0f);
+
+    // Web UI defaults
+    control.positionPid[0].setP(20);
+    control.positionPid[0].setI(15);
+    control.positionPid[0].setD(0);
+    control.moveTo(0, 45);
+    control.positionPid[1].setP(2);
+    control.positionPid[1].setI(0);
+    control.positionPid[1].setD(0);
+    control.moveTo(1, 30);
+    if (cascade) {
+        control.positionPid[0].setP(10);
+        control.positionPid[0].setI(0);
+        control.velocityPid[0].setP(1.5f);
+        control.velocityPid[0].setI(20);
+        control.setMode(0, ControlLoop::CASCADE);
+    }
+    if (autotune) control.startAutotune(0, Autotuner::Settings());
+    if (teleopMode) {
+        int port = argc > 2 ? atoi(argv[2]) : 4210;
+        long seconds = argc > 3 ? atol(argv[3]) : 10;
+        return serveTeleop(port, seconds, clock, arm, wrist, acquisition, control);
+    }
+
+    std::vector<long> latency(ticks);
+    auto start = std::chrono::steady_clock::now();
+    for (long i = 0; i < ticks; i++) {
+        clock.advance(period);
+        arm.advance(period);
+        wrist.advance(period);
+
+        auto t0 = std::chrono::steady_clock::now();
+        acquisition.sample();
+        control.step();
+        capture.record(control.lastTick());
+        auto t1 = std::chrono::steady_clock::now();
+        latency[i] = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count();
+    }
+    double total = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (ticks == 0) return 0;
+    std::sort(latency.begin(), latency.end());
+    double mean = 0;
+    for (long l : latency) mean += l;
+    mean /= ticks;
+
+    printf("ticks:        %ld (period %lu us, simulated %.2f s, arm %s)\n",
+           ticks, period, ticks * period / 1e6, cascade ? "cascaded" : "position loop");
+    printf("throughput:   %.0f ticks/s\n", ticks / total);
+    printf("tick latency: mean %.0f ns, p50 %ld ns, p99 %ld ns, max %ld ns\n",
+           mean, latency[ticks / 2], latency[ticks * 99 / 100], latency[ticks - 1]);
+    if (capture.state() == Capture::DONE) {
+        printf("capture:      %lu ticks, %lu before trigger (cause %u), %lu bytes\n",
+               (unsigned long)capture.count(), (unsigned long)capture.pre(), capture.cause(),
+               (unsigned long)capture.size());
+    }
+    if (autotune) {
+        const Autotuner::Result &r = control.autotune.result();
+        if (control.autotune.state() == Autotuner::DONE) {
+            printf("autotune:     Ku %.2f, Tu %.3f s -> P %.2f I %.2f D %.3f, overshoot %.1f%%, settling %.3f s%s\n",
+                   r.ku, r.tu, r.kp, r.ki, r.kd, r.overshoot, r.settlingTime, r.settled ? "" : " (not settled)");
+        } else {
+            printf("autotune:     state %d %s\n", control.autotune.state(), control.autotune.failure());
+        }
+    }
+    const TickRecord &last = control.lastTick();
+    printf("final:        arm %.2f deg (sp %.2f), wrist %.2f deg (sp %.2f)\n",
+           control.angle(0), last.joint[0].setpoint, control.angle(1), last.joint[1].setpoint);
+
+    if (metrics) {
+        StdoutMetrics out;
+        writeMetricHeader(out, "robotarm_loop_rate_hz", "gauge", "Achieved loop rate");
+        out.printf("robotarm_loop_rate_hz{loop=\"control\"} %.1f\n", ticks / total);
+        writeStageHeader(out);
+        writeControlStages(out, acquisition, control, clock.cyclesPerSecond());
+    }
+    return 0;
+}